@@ -48,7 +48,8 @@
 #include "syncobj.h"
 
 
-#define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 2000
+#define ABSTRACT_SERVER_SEND_QUE_MAX_BYTES        (128*1024*1024)
+#define ABSTRACT_SERVER_SEND_GATHER_MAX_COUNT     64
 
 namespace epee
 {
@@ -93,6 +94,8 @@ namespace net_utils
   private:
     //----------------- i_service_endpoint ---------------------
     virtual bool do_send(const void* ptr, size_t cb);
+    virtual bool do_send(const shared_send_buffer& buff);
+    virtual bool do_send(const shared_send_stream& stream);
     virtual bool close();
     virtual bool call_run_once_service_io();
     virtual bool request_callback();
@@ -108,6 +111,8 @@ namespace net_utils
 
     /// Handle completion of a write operation.
     void handle_write(const boost::system::error_code& e, size_t cb);
+    /// Writes queued buffers at once, m_send_que_lock should be taken. Returns false if the que is over.
+    bool start_write(const boost::shared_ptr<connection<t_protocol_handler> >& self);
 
     /// Strand to ensure the connection's handlers are not called concurrently.
     boost::asio::io_service::strand strand_;
@@ -122,7 +127,14 @@ namespace net_utils
     volatile uint32_t m_want_close_connection;
     std::atomic<bool> m_was_shutdown;
     critical_section m_send_que_lock;
-    std::list<std::string> m_send_que;
+    struct send_que_entry
+    {
+      shared_send_buffer buff;
+      shared_send_stream stream;                  //its next part is taken to buff when the previous one is written
+    };
+    std::list<send_que_entry> m_send_que;
+    uint64_t m_send_que_bytes;
+    size_t m_send_que_writing;                    //buffers from the que front being written now
     volatile uint32_t& m_ref_sockets_count;
     i_connection_filter* &m_pfilter;
     volatile bool m_is_multithreaded;
@@ -55,6 +55,8 @@ DISABLE_VS_WARNINGS(4355)
                             m_protocol_handler(this, config, context), 
                             m_want_close_connection(0), 
                             m_was_shutdown(0), 
+                            m_send_que_bytes(0), 
+                            m_send_que_writing(0), 
                             m_ref_sockets_count(sock_count), 
                             m_pfilter(pfilter)
   {
@@ -295,6 +297,12 @@ DISABLE_VS_WARNINGS(4355)
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
   bool connection<t_protocol_handler>::do_send(const void* ptr, size_t cb)
+  {
+    return do_send(shared_send_buffer(new std::string((const char*)ptr, cb)));
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send(const shared_send_buffer& buff)
   {
     TRY_ENTRY();
     // Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
@@ -304,6 +312,7 @@ DISABLE_VS_WARNINGS(4355)
     if(m_was_shutdown)
       return false;
 
+    size_t cb = buff->size();
     LOG_PRINT("[sock " << socket_.native_handle() << "] SEND " << cb, LOG_LEVEL_4);
     context.m_last_send = time(NULL);
     context.m_send_cnt += cb;
@@ -311,18 +320,21 @@ DISABLE_VS_WARNINGS(4355)
     //request complete
     
     epee::critical_region_t<decltype(m_send_que_lock)> send_guard(m_send_que_lock);
-    if(m_send_que.size() > ABSTRACT_SERVER_SEND_QUE_MAX_COUNT)
+    if(m_send_que_bytes + cb > ABSTRACT_SERVER_SEND_QUE_MAX_BYTES)
     {
+      uint64_t que_bytes = m_send_que_bytes;
       send_guard.unlock();
-      LOG_ERROR("send to [" << print_connection_context_short(context) << ", (" << (void*)this << ")] que size is more than ABSTRACT_SERVER_SEND_QUE_MAX_COUNT(" << ABSTRACT_SERVER_SEND_QUE_MAX_COUNT << "), shutting down connection");
+      LOG_ERROR("send to [" << print_connection_context_short(context) << ", (" << (void*)this << ")] que size " << que_bytes << " + " << cb << " bytes is more than ABSTRACT_SERVER_SEND_QUE_MAX_BYTES(" << ABSTRACT_SERVER_SEND_QUE_MAX_BYTES << "), shutting down connection");
       close();
       return false;
     }
 
-    m_send_que.resize(m_send_que.size()+1);
-    m_send_que.back().assign((const char*)ptr, cb);
+    send_que_entry entry;
+    entry.buff = buff;
+    m_send_que.push_back(entry);
+    m_send_que_bytes += cb;
     
-    if(m_send_que.size() > 1)
+    if(m_send_que_writing)
     {
       //active operation should be in progress, nothing to do, just wait last operation callback
     }else
@@ -333,14 +345,7 @@ DISABLE_VS_WARNINGS(4355)
         LOG_ERROR("Looks like no active operations, but send que size != 1!!");
         return false;
       }
-
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-        boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-        //)
-        );
-
-      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Assync send requested " << m_send_que.front().size());
+      start_write(self);
     }
 
     return true;
@@ -349,6 +354,71 @@ DISABLE_VS_WARNINGS(4355)
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send(const shared_send_stream& stream)
+  {
+    TRY_ENTRY();
+    auto self = safe_shared_from_this();
+    if(!self)
+      return false;
+    if(m_was_shutdown)
+      return false;
+
+    LOG_PRINT("[sock " << socket_.native_handle() << "] SEND STREAM " << stream->get_size(), LOG_LEVEL_4);
+    context.m_last_send = time(NULL);
+    context.m_send_cnt += stream->get_size();
+
+    CRITICAL_REGION_LOCAL(m_send_que_lock);
+    send_que_entry entry;
+    entry.stream = stream;
+    m_send_que.push_back(entry);
+    if(!m_send_que_writing)
+      start_write(self);
+    return true;
+
+    CATCH_ENTRY_L0("connection<t_protocol_handler>::do_send(stream)", false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::start_write(const boost::shared_ptr<connection<t_protocol_handler> >& self)
+  {
+    //queued buffers (levin header and shared body, or several small packets) go to the socket with one gathering write,
+    //they are kept alive in the que until handle_write
+    std::vector<boost::asio::const_buffer> buffers;
+    size_t cb = 0;
+    for(auto it = m_send_que.begin(); it != m_send_que.end() && buffers.size() < ABSTRACT_SERVER_SEND_GATHER_MAX_COUNT;)
+    {
+      if(!it->buff)
+      {
+        it->buff = it->stream->get_next_part();
+        if(!it->buff)
+        {
+          it = m_send_que.erase(it);
+          continue;
+        }
+        m_send_que_bytes += it->buff->size();
+      }
+      buffers.push_back(boost::asio::buffer(it->buff->data(), it->buff->size()));
+      cb += it->buff->size();
+      //the stream is kept in the que with only one part taken
+      if(it->stream)
+        break;
+      ++it;
+    }
+    m_send_que_writing = buffers.size();
+    if(buffers.empty())
+      return false;
+
+    boost::asio::async_write(socket_, buffers,
+      //strand_.wrap(
+      boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
+      //)
+      );
+
+    LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Assync send requested " << cb << " bytes in " << buffers.size() << " buffers");
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool connection<t_protocol_handler>::shutdown()
   {
     // Initiate graceful connection closure.
@@ -405,20 +475,23 @@ DISABLE_VS_WARNINGS(4355)
       return;
     }
 
-    m_send_que.pop_front();
-    if(m_send_que.empty())
+    for(; m_send_que_writing && !m_send_que.empty(); m_send_que_writing--)
+    {
+      send_que_entry& entry = m_send_que.front();
+      m_send_que_bytes -= entry.buff->size();
+      if(entry.stream)
+        entry.buff.reset();
+      else
+        m_send_que.pop_front();
+    }
+    m_send_que_writing = 0;
+    //send more data if any
+    if(!start_write(connection<t_protocol_handler>::shared_from_this()))
     {
       if(boost::interprocess::ipcdetail::atomic_read32(&m_want_close_connection))
       {
         do_shutdown = true;
       }
-    }else
-    {
-      //have more data to send
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-          boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2));
-        //);
     }
     CRITICAL_REGION_END();
 
@@ -28,6 +28,7 @@
 
 #pragma once
 #include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/regex.hpp>
 
 #include "string_tools.h"
@@ -35,6 +36,8 @@ namespace epee
 {
 namespace net_utils
 {
+	struct i_send_stream;
+
 	namespace http
 	{
 
@@ -88,6 +91,48 @@ namespace net_utils
 
 
 
+		enum http_range_result
+		{
+			http_range_none,            //no range or it isn't supported, the whole body is sent
+			http_range_ok,
+			http_range_not_satisfiable
+		};
+		//"bytes=first-last", "bytes=first-" or "bytes=-suffix_length", several ranges at once aren't supported
+		inline
+		http_range_result parse_bytes_range(const std::string& range, uint64_t size, uint64_t& offset, uint64_t& count)
+		{
+			std::string r = string_tools::trim(range);
+			if(r.compare(0, 6, "bytes=") != 0 || r.find(',') != std::string::npos)
+				return http_range_none;
+			std::string::size_type dash = r.find('-', 6);
+			if(dash == std::string::npos)
+				return http_range_none;
+			std::string first = string_tools::trim(r.substr(6, dash - 6));
+			std::string last = string_tools::trim(r.substr(dash + 1));
+			uint64_t first_pos = 0, last_pos = 0;
+			if(first.empty())
+			{
+				if(!string_tools::get_xtype_from_string(last_pos, last))
+					return http_range_none;
+				if(!last_pos || !size)
+					return http_range_not_satisfiable;
+				count = std::min(last_pos, size);
+				offset = size - count;
+				return http_range_ok;
+			}
+			if(!string_tools::get_xtype_from_string(first_pos, first))
+				return http_range_none;
+			if(last.size() && (!string_tools::get_xtype_from_string(last_pos, last) || last_pos < first_pos))
+				return http_range_none;
+			if(first_pos >= size)
+				return http_range_not_satisfiable;
+			if(last.empty() || last_pos >= size)
+				last_pos = size - 1;
+			offset = first_pos;
+			count = last_pos - first_pos + 1;
+			return http_range_ok;
+		}
+
 		struct http_header_info
 		{
 			std::string m_connection;       //"Connection:"
@@ -168,6 +213,7 @@ namespace net_utils
 			std::string			m_response_comment;
 			fields_list	        m_additional_fields;
 			std::string			m_body;
+			boost::shared_ptr<i_send_stream> m_body_stream; //long body, sent after m_body by parts
 			std::string			m_mime_tipe;
 			http_header_info    m_header_info;
 			int                 m_http_ver_hi;// OUT paramter only
@@ -123,6 +123,7 @@ namespace net_utils
 			bool slash_to_back_slash(std::string& str);
 			std::string get_file_mime_tipe(const std::string& path);
 			std::string get_response_header(const http_response_info& response);
+			void apply_body_range(const http_request_info& query_info, http_response_info& response);
 
 			//major function 
 			inline bool handle_request_and_send_response(const http::http_request_info& query_info);
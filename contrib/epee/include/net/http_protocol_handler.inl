@@ -539,6 +539,8 @@ namespace net_utils
 		http_response_info response;
 		bool res = handle_request(query_info, response);
 		//CHECK_AND_ASSERT_MES(res, res, "handle_request(query_info, response) returned false" );
+		if(response.m_body_stream)
+			apply_body_range(query_info, response);
 
 		std::string response_data = get_response_header(response);
 		
@@ -548,9 +550,41 @@ namespace net_utils
 		m_psnd_hndlr->do_send((void*)response_data.data(), response_data.size());
 		if(response.m_body.size())
 			m_psnd_hndlr->do_send((void*)response.m_body.data(), response.m_body.size());
+		if(response.m_body_stream)
+			m_psnd_hndlr->do_send(response.m_body_stream);
 		return res;
 	}
 	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	void simple_http_connection_handler<t_connection_context>::apply_body_range(const http_request_info& query_info, http_response_info& response)
+	{
+		//ranges are served only for bodies which are streamed as a whole
+		std::string range = get_value_from_fields_list("Range", query_info.m_header_info.m_etc_fields);
+		if(range.empty() || response.m_response_code != 200 || response.m_body.size())
+			return;
+		//the client has a part of another version of the body
+		std::string if_range = get_value_from_fields_list("If-Range", query_info.m_header_info.m_etc_fields);
+		if(if_range.size() && string_tools::trim(if_range) != string_tools::trim(get_value_from_fields_list("ETag", response.m_additional_fields)))
+			return;
+
+		uint64_t size = response.m_body_stream->get_size();
+		uint64_t offset = 0, count = 0;
+		http_range_result r = parse_bytes_range(range, size, offset, count);
+		if(r == http_range_not_satisfiable)
+		{
+			response.m_response_code = 416;
+			response.m_response_comment = "Requested Range Not Satisfiable";
+			response.m_body_stream.reset();
+			response.m_additional_fields.push_back(std::make_pair("Content-Range", " bytes */" + boost::lexical_cast<std::string>(size)));
+		}else if(r == http_range_ok && response.m_body_stream->set_range(offset, count))
+		{
+			response.m_response_code = 206;
+			response.m_response_comment = "Partial Content";
+			response.m_additional_fields.push_back(std::make_pair("Content-Range", " bytes " + boost::lexical_cast<std::string>(offset) + "-" +
+				boost::lexical_cast<std::string>(offset + count - 1) + "/" + boost::lexical_cast<std::string>(size)));
+		}
+	}
+	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_request(const http::http_request_info& query_info, http_response_info& response)
 	{
@@ -589,7 +623,7 @@ namespace net_utils
 		buf += boost::lexical_cast<std::string>(response.m_response_code) + " " + response.m_response_comment + "\r\n" +
 			"Server: Epee-based\r\n"
 			"Content-Length: ";
-		buf += boost::lexical_cast<std::string>(response.m_body.size()) + "\r\n";
+		buf += boost::lexical_cast<std::string>(response.m_body.size() + (response.m_body_stream ? response.m_body_stream->get_size() : 0)) + "\r\n";
 		buf += "Content-Type: ";
 		buf += response.m_mime_tipe + "\r\n";
 
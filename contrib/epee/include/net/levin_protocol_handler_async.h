@@ -42,6 +42,25 @@ namespace epee
 namespace levin
 {
 
+//frames notification once, so the same packet could be sent to any number of connections
+inline net_utils::shared_send_buffer make_notify_packet(int command, const std::string& in_buff)
+{
+  bucket_head2 head = {0};
+  head.m_signature = LEVIN_SIGNATURE;
+  head.m_have_to_return_data = false;
+  head.m_cb = in_buff.size();
+
+  head.m_command = command;
+  head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
+  head.m_flags = LEVIN_PACKET_REQUEST;
+
+  boost::shared_ptr<std::string> packet(new std::string());
+  packet->reserve(sizeof(head) + in_buff.size());
+  packet->append(reinterpret_cast<const char*>(&head), sizeof(head));
+  packet->append(in_buff);
+  return packet;
+}
+
 /************************************************************************/
 /*                                                                      */
 /************************************************************************/
@@ -76,6 +95,7 @@ public:
   int invoke_async(int command, const std::string& in_buff, boost::uuids::uuid connection_id, callback_t cb, size_t timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED);
 
   int notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id);
+  int notify(const net_utils::shared_send_buffer& packet, boost::uuids::uuid connection_id);
   bool close(boost::uuids::uuid connection_id);
   bool update_connection_context(const t_connection_context& contxt);
   bool request_callback(boost::uuids::uuid connection_id);
@@ -661,6 +681,12 @@ public:
   }
 
   int notify(int command, const std::string& in_buff)
+  {
+    return notify(make_notify_packet(command, in_buff));
+  }
+
+  //packet made by make_notify_packet()
+  int notify(const net_utils::shared_send_buffer& packet)
   {
     misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler(
                           boost::bind(&async_protocol_handler::finish_outer_call, this));
@@ -673,27 +699,14 @@ public:
     if(m_deletion_initiated)
       return LEVIN_ERROR_CONNECTION_DESTROYED;
 
-    bucket_head2 head = {0};
-    head.m_signature = LEVIN_SIGNATURE;
-    head.m_have_to_return_data = false;
-    head.m_cb = in_buff.size();
-
-    head.m_command = command;
-    head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
-    head.m_flags = LEVIN_PACKET_REQUEST;
     CRITICAL_REGION_BEGIN(m_send_lock);
-    if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
-    {
-      LOG_PRINT_CC_RED(m_connection_context, "Failed to do_send()", LOG_LEVEL_2);
-      return -1;
-    }
-
-    if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+    if(!m_pservice_endpoint->do_send(packet))
     {
       LOG_PRINT_CC_RED(m_connection_context, "Failed to do_send()", LOG_LEVEL_2);
       return -1;
     }
     CRITICAL_REGION_END();
+    const bucket_head2& head = *reinterpret_cast<const bucket_head2*>(packet->data());
     LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_SENT. [len=" << head.m_cb << 
       ", f=" << head.m_flags << 
       ", r?=" << head.m_have_to_return_data <<
@@ -822,6 +835,14 @@ int async_protocol_handler_config<t_connection_context>::notify(int command, con
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context>
+int async_protocol_handler_config<t_connection_context>::notify(const net_utils::shared_send_buffer& packet, boost::uuids::uuid connection_id)
+{
+  async_protocol_handler<t_connection_context>* aph;
+  int r = find_and_lock_connection(connection_id, aph);
+  return LEVIN_OK == r ? aph->notify(packet) : r;
+}
+//------------------------------------------------------------------------------------------
+template<class t_connection_context>
 bool async_protocol_handler_config<t_connection_context>::close(boost::uuids::uuid connection_id)
 {
   CRITICAL_REGION_LOCAL(m_connects_lock);
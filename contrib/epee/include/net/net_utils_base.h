@@ -30,6 +30,7 @@
 #define _NET_UTILS_BASE_H_
 
 #include <boost/uuid/uuid.hpp>
+#include <boost/shared_ptr.hpp>
 #include "string_tools.h"
 
 #ifndef MAKE_IP
@@ -99,9 +100,80 @@ namespace net_utils
 	/************************************************************************/
 	/*                                                                      */
 	/************************************************************************/
+	//immutable, already framed data, which could be queued to several connections without copying
+	typedef boost::shared_ptr<const std::string> shared_send_buffer;
+
+	//long output, which is taken by parts as the previous ones are written, so it is never queued at once
+	struct i_send_stream
+	{
+		virtual ~i_send_stream(){}
+		//bytes left to be taken
+		virtual uint64_t get_size()=0;
+		//limits the output to size bytes from offset, should be called before the first part is taken
+		virtual bool set_range(uint64_t offset, uint64_t size)=0;
+		//returns empty buffer when the stream is over
+		virtual shared_send_buffer get_next_part()=0;
+	};
+	typedef boost::shared_ptr<i_send_stream> shared_send_stream;
+
+	//stream over buffers, which could be shared with other streams, only the range edges are copied
+	class buffers_send_stream: public i_send_stream
+	{
+	public:
+		buffers_send_stream(const std::vector<shared_send_buffer>& buffers):m_buffers(buffers), m_index(0), m_offset(0), m_size(0)
+		{
+			for(size_t i = 0; i != m_buffers.size(); i++)
+				m_size += m_buffers[i]->size();
+		}
+		virtual uint64_t get_size(){return m_size;}
+		virtual bool set_range(uint64_t offset, uint64_t size)
+		{
+			uint64_t total = 0;
+			for(size_t i = 0; i != m_buffers.size(); i++)
+				total += m_buffers[i]->size();
+			if(offset > total || size > total - offset)
+				return false;
+			for(m_index = 0; m_index != m_buffers.size() && offset >= m_buffers[m_index]->size(); m_index++)
+				offset -= m_buffers[m_index]->size();
+			m_offset = static_cast<size_t>(offset);
+			m_size = size;
+			return true;
+		}
+		virtual shared_send_buffer get_next_part()
+		{
+			while(m_size && m_index != m_buffers.size())
+			{
+				const shared_send_buffer& buff = m_buffers[m_index++];
+				size_t offset = m_offset;
+				m_offset = 0;
+				size_t cb = static_cast<size_t>(std::min<uint64_t>(buff->size() - offset, m_size));
+				if(!cb)
+					continue;
+				m_size -= cb;
+				if(cb == buff->size())
+					return buff;
+				return shared_send_buffer(new std::string(buff->data() + offset, cb));
+			}
+			return shared_send_buffer();
+		}
+	private:
+		std::vector<shared_send_buffer> m_buffers;
+		size_t m_index;
+		size_t m_offset;
+		uint64_t m_size;
+	};
+
 	struct i_service_endpoint
 	{
 		virtual bool do_send(const void* ptr, size_t cb)=0;
+    virtual bool do_send(const shared_send_buffer& buff){return do_send(buff->data(), buff->size());}
+    virtual bool do_send(const shared_send_stream& stream)
+    {
+      for(shared_send_buffer part = stream->get_next_part(); part; part = stream->get_next_part())
+        if(!do_send(part))
+          return false;
+      return true;
+    }
     virtual bool close()=0;
     virtual bool call_run_once_service_io()=0;
     virtual bool request_callback()=0;
@@ -32,9 +32,13 @@
 
 #include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <map>
+#include <stdexcept>
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/shared_mutex.hpp>
 
 
 
@@ -155,6 +159,105 @@ namespace epee
   };
 
 
+  // shared/exclusive lock, recursive on both sides for the same thread:
+  //  - lock()/unlock() is exclusive, the owner may re-enter both lock() and lock_shared() (the latter is counted as exclusive)
+  //  - lock_shared()/unlock_shared() is shared, nested calls only increase per-thread counter and never touch the
+  //    underlying mutex, so a thread holding shared access can't be blocked by a writer waiting in the queue
+  //  - shared -> exclusive upgrade is not supported (would deadlock with another shared owner), lock() throws in that case
+  class recursive_shared_critical_section
+  {
+  public:
+    recursive_shared_critical_section()
+      : m_exclusive_depth(0)
+    {}
+
+    void lock()
+    {
+      std::thread::id this_id = std::this_thread::get_id();
+      {
+        std::lock_guard<std::mutex> guard(m_state_lock);
+        if (m_exclusive_owner == this_id)
+        {
+          ++m_exclusive_depth;
+          return;
+        }
+        if (m_shared_depth.count(this_id))
+          throw std::logic_error("recursive_shared_critical_section: shared to exclusive lock upgrade is not supported");
+      }
+      m_section.lock();
+      std::lock_guard<std::mutex> guard(m_state_lock);
+      m_exclusive_owner = this_id;
+      m_exclusive_depth = 1;
+    }
+
+    void unlock()
+    {
+      {
+        std::lock_guard<std::mutex> guard(m_state_lock);
+        if (--m_exclusive_depth)
+          return;
+        m_exclusive_owner = std::thread::id();
+      }
+      m_section.unlock();
+    }
+
+    // returns true if the underlying shared lock was actually acquired by this call,
+    // i.e. this is the outermost shared region of the thread and the thread is not an exclusive owner
+    bool lock_shared()
+    {
+      std::thread::id this_id = std::this_thread::get_id();
+      {
+        std::lock_guard<std::mutex> guard(m_state_lock);
+        if (m_exclusive_owner == this_id)
+        {
+          ++m_exclusive_depth;
+          return false;
+        }
+        auto it = m_shared_depth.find(this_id);
+        if (it != m_shared_depth.end())
+        {
+          ++it->second;
+          return false;
+        }
+      }
+      m_section.lock_shared();
+      std::lock_guard<std::mutex> guard(m_state_lock);
+      m_shared_depth[this_id] = 1;
+      return true;
+    }
+
+    void unlock_shared()
+    {
+      std::thread::id this_id = std::this_thread::get_id();
+      {
+        std::lock_guard<std::mutex> guard(m_state_lock);
+        if (m_exclusive_owner == this_id)
+        {
+          --m_exclusive_depth;
+          return;
+        }
+        auto it = m_shared_depth.find(this_id);
+        if (it == m_shared_depth.end())
+          throw std::logic_error("recursive_shared_critical_section: unlock_shared() without lock_shared()");
+        if (--it->second)
+          return;
+        m_shared_depth.erase(it);
+      }
+      m_section.unlock_shared();
+    }
+
+  private:
+    recursive_shared_critical_section(const recursive_shared_critical_section&);
+    recursive_shared_critical_section& operator=(const recursive_shared_critical_section&);
+
+    boost::shared_mutex m_section;
+    std::mutex m_state_lock;                          // protects members below
+    std::thread::id m_exclusive_owner;
+    size_t m_exclusive_depth;
+    std::map<std::thread::id, size_t> m_shared_depth; // thread id -> shared recursion depth
+  };
+
+
 #if defined(WINDWOS_PLATFORM)
   class shared_critical_section
   {
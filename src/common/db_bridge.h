@@ -4,11 +4,16 @@
 #pragma once
 
 #include <set>
+#include <algorithm>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <boost/functional/hash.hpp>
 #include "misc_language.h"
 #include "misc_log_ex.h"
 #include "currency_core/currency_format_utils.h"
 #include "epee/include/db_helpers.h"
+#include "db_lru_cache.h"
 
 namespace db
 {
@@ -47,6 +52,13 @@ namespace db
     virtual void abort_transaction() = 0;
 
     virtual bool get(const table_id tid, const char* key_data, size_t key_size, std::string& out_buffer) = 0;
+    // zero-copy get: value_data passed to the visitor points directly to db memory and is valid only within the callback
+    // return value: false if the key was not found or the visitor returned false
+    virtual bool get_and_visit(const table_id tid, const char* key_data, size_t key_size, i_db_visitor* visitor) = 0;
+    // batched zero-copy get: keys_count keys of key_size bytes each are laid out contiguously in keys_data and looked up with one cursor,
+    // so keys sorted in db key order are read with sequential page access; visitor is called with i == key's position for each key found
+    // return value: false on db error or if the visitor returned false
+    virtual bool get_multiple_and_visit(const table_id tid, const char* keys_data, size_t key_size, size_t keys_count, i_db_visitor* visitor) = 0;
     virtual bool set(const table_id tid, const char* key_data, size_t key_size, const char* value_data, size_t value_size) = 0;
     virtual bool erase(const table_id tid, const char* key_data, size_t key_size) = 0;
 
@@ -56,6 +68,32 @@ namespace db
     {};
   };
 
+  template<typename callback_t>
+  struct lambda_value_visitor : public i_db_visitor
+  {
+    callback_t& m_callback;
+    lambda_value_visitor(callback_t& cb) : m_callback(cb)
+    {}
+
+    virtual bool on_visit_db_item(size_t i, const void* key_data, size_t key_size, const void* value_data, size_t value_size) override
+    {
+      return m_callback(value_data, value_size);
+    }
+  };
+
+  template<typename callback_t>
+  struct lambda_indexed_value_visitor : public i_db_visitor
+  {
+    callback_t& m_callback;
+    lambda_indexed_value_visitor(callback_t& cb) : m_callback(cb)
+    {}
+
+    virtual bool on_visit_db_item(size_t i, const void* key_data, size_t key_size, const void* value_data, size_t value_size) override
+    {
+      return m_callback(i, value_data, value_size);
+    }
+  };
+
   // POD table keys accessors
   template<class tkey_pod_t>
   const char* tkey_to_pointer(const tkey_pod_t& tkey, size_t& len_out) 
@@ -87,6 +125,30 @@ namespace db
     key_out.assign(reinterpret_cast<const char*>(pointer), static_cast<size_t>(len));
   }
 
+  // hashing and comparison of table keys by their db representation
+  template<class tkey_t>
+  struct tkey_hasher
+  {
+    size_t operator()(const tkey_t& k) const
+    {
+      size_t len = 0;
+      const char* p = tkey_to_pointer(k, len);
+      return boost::hash_range(p, p + len);
+    }
+  };
+
+  template<class tkey_t>
+  struct tkey_equal
+  {
+    bool operator()(const tkey_t& a, const tkey_t& b) const
+    {
+      size_t len_a = 0, len_b = 0;
+      const char* p_a = tkey_to_pointer(a, len_a);
+      const char* p_b = tkey_to_pointer(b, len_b);
+      return len_a == len_b && memcmp(p_a, p_b, len_a) == 0;
+    }
+  };
+
 
   ////////////////////////////////////////////////////////////
   // db_bridge_base
@@ -112,6 +174,7 @@ namespace db
         return true;
       // TODO     !!!
       bool r = m_db_adapter_ptr->begin_transaction(read_only_access);
+      on_transaction_begun(read_only_access); // the adapter keeps a stack entry even if it failed, so do we
       return r;
     }
 
@@ -121,6 +184,7 @@ namespace db
         return;
       // TODO    !!!
       bool r = m_db_adapter_ptr->commit_transaction();
+      on_transaction_finished(r);
       CHECK_AND_ASSERT_THROW_MES(r, "commit_transaction failed");
     }
 
@@ -131,13 +195,14 @@ namespace db
         return;
       // TODO     !!!
       m_db_adapter_ptr->abort_transaction();
-      
+      on_transaction_finished(false);
     }
 
     bool begin_batch_exclusive_operation()
     {
       bool r = m_db_adapter_ptr->begin_transaction(false);
       if (!r) return false;
+      on_transaction_begun(false);
       m_is_batch_exclusive = true;
       m_was_aborts = false; 
       return true;
@@ -146,10 +211,12 @@ namespace db
     bool finish_batch_exclusive_operation(bool success)
     {
       m_is_batch_exclusive = false;
+      bool r = false;
       if (success)
-        m_db_adapter_ptr->commit_transaction();
+        r = m_db_adapter_ptr->commit_transaction();
       else
         m_db_adapter_ptr->abort_transaction();
+      on_transaction_finished(r);
       
       CHECK_AND_ASSERT_MES2(!success || (success && !m_was_aborts), "internal error: success = " << success << ", m_was_aborts = " << m_was_aborts);
       return true;
@@ -198,17 +265,36 @@ namespace db
       return m_db_adapter_ptr->erase(tid, key_data, key_size);
     }
 
-    template<class tkey_pod_t, class t_object>
-    bool get_serializable_object(const table_id tid, const tkey_pod_t& tkey, t_object& obj) const
+    template<class tkey_pod_t, class callback_t>
+    bool get_and_visit(const table_id tid, const tkey_pod_t& tkey, callback_t callback) const
     {
-      std::string buffer;
       size_t key_size = 0;
       const char* key_data = tkey_to_pointer(tkey, key_size);
 
-      if (!m_db_adapter_ptr->get(tid, key_data, key_size, buffer))
-        return false;
+      lambda_value_visitor<callback_t> visitor(callback);
+      return m_db_adapter_ptr->get_and_visit(tid, key_data, key_size, &visitor);
+    }
+
+    // callback(i, value_data, value_size) is called for each found key, i is the key's position in keys
+    template<class tkey_pod_t, class callback_t>
+    bool get_multiple_and_visit(const table_id tid, const std::vector<tkey_pod_t>& keys, callback_t callback) const
+    {
+      static_assert(std::is_pod<tkey_pod_t>::value, "pod type expected");
+      if (keys.empty())
+        return true;
 
-      return currency::t_unserializable_object_from_blob(obj, buffer);
+      lambda_indexed_value_visitor<callback_t> visitor(callback);
+      return m_db_adapter_ptr->get_multiple_and_visit(tid, reinterpret_cast<const char*>(keys.data()), sizeof(tkey_pod_t), keys.size(), &visitor);
+    }
+
+    template<class tkey_pod_t, class t_object>
+    bool get_serializable_object(const table_id tid, const tkey_pod_t& tkey, t_object& obj) const
+    {
+      // unserialize right from the db memory, without intermediate buffer
+      return get_and_visit(tid, tkey, [&obj](const void* value_data, size_t value_size) -> bool
+      {
+        return currency::t_unserializable_object_from_blob(obj, value_data, value_size);
+      });
     }
 
     template<class tkey_pod_t, class t_object>
@@ -227,17 +313,12 @@ namespace db
     {
       static_assert(std::is_pod<t_object_pod_t>::value, "POD type expected");
 
-      std::string buffer;
-      size_t key_size = 0;
-      const char* key_data = tkey_to_pointer(tkey, key_size);
-
-      if (!m_db_adapter_ptr->get(tid, key_data, key_size, buffer))
-        return false;
-
-      CHECK_AND_ASSERT_MES(sizeof(t_object_pod_t) == buffer.size(), false, "get " << buffer.size() << " bytes of data, while " << sizeof(t_object_pod_t) << " bytes is expected as sizeof(t_object_pod_t)");
-
-      obj = *reinterpret_cast<const t_object_pod_t*>(buffer.data());
-      return true;
+      return get_and_visit(tid, tkey, [&obj](const void* value_data, size_t value_size) -> bool
+      {
+        CHECK_AND_ASSERT_MES(sizeof(t_object_pod_t) == value_size, false, "get " << value_size << " bytes of data, while " << sizeof(t_object_pod_t) << " bytes is expected as sizeof(t_object_pod_t)");
+        memcpy(&obj, value_data, sizeof obj); // db memory is not guaranteed to be aligned
+        return true;
+      });
     }
 
     template<class tkey_pod_t, class t_object_pod_t>
@@ -275,6 +356,46 @@ namespace db
       bool m_was_aborts;
 
     private:
+      // Write transactions are serialized by the adapter, so there's at most one writer thread at a time.
+      // Its transactions are tracked to notify attached containers when the outermost write transaction begins and ends.
+      void on_transaction_begun(bool read_only_access)
+      {
+        if (m_writer_thread_id == std::this_thread::get_id())
+        {
+          m_writer_tx_stack.push_back(read_only_access);
+          return;
+        }
+        if (read_only_access)
+          return;
+
+        m_writer_thread_id = std::this_thread::get_id();
+        m_writer_tx_stack.push_back(read_only_access);
+        notify_container_receivers(&i_db_write_tx_notification_receiver::on_write_transaction_begin);
+      }
+
+      void on_transaction_finished(bool committed)
+      {
+        if (m_writer_thread_id != std::this_thread::get_id())
+          return;
+        CHECK_AND_ASSERT_MES_NO_RET(!m_writer_tx_stack.empty(), "internal error: writer transactions stack is empty");
+        m_writer_tx_stack.pop_back();
+        if (!m_writer_tx_stack.empty())
+          return;
+
+        m_writer_thread_id = std::thread::id();
+        notify_container_receivers(committed ? &i_db_write_tx_notification_receiver::on_write_transaction_commit : &i_db_write_tx_notification_receiver::on_write_transaction_abort);
+      }
+
+      void notify_container_receivers(void (i_db_write_tx_notification_receiver::*p_handler)())
+      {
+        CRITICAL_REGION_LOCAL(m_attached_container_receivers_lock);
+        for (auto receiver : m_attached_container_receivers)
+          (receiver->*p_handler)();
+      }
+
+      std::atomic<std::thread::id> m_writer_thread_id;
+      std::vector<bool> m_writer_tx_stack; // read_only flags of writer thread's transactions, accessed by the writer thread only
+
       epee::critical_section m_attached_container_receivers_lock;
       std::set<i_db_write_tx_notification_receiver*> m_attached_container_receivers;
 
@@ -288,7 +409,7 @@ namespace db
     static bool tvalue_from_pointer(const void* p, size_t s, value_t& v)
     {
       CHECK_AND_ASSERT_THROW_MES(s == sizeof(value_t), "wrong argument s = " << s << "expected: " << sizeof(value_t));
-      v = *reinterpret_cast<const value_t*>(p);
+      memcpy(&v, p, sizeof v);
       return true;
     }
 
@@ -318,8 +439,7 @@ namespace db
     template<class value_t>
     static bool tvalue_from_pointer(const void* p, size_t s, value_t& v)
     {
-      std::string buffer(static_cast<const char*>(p), s);
-      return t_unserializable_object_from_blob(v, buffer);
+      return currency::t_unserializable_object_from_blob(v, p, s);
     }
 
     template<class key_t, class value_t>
@@ -420,15 +540,33 @@ namespace db
     // interface i_db_write_tx_notification_receiver
     virtual void on_write_transaction_abort() override
     {
+      if (m_cache)
+        m_cache->on_write_transaction_end();
       m_exclusive_runner.clear_exclusive_mode_for_this_thread();
     }
 
     // interface i_db_write_tx_notification_receiver
     virtual void on_write_transaction_commit() override
     {
+      if (m_cache)
+        m_cache->on_write_transaction_end();
       m_exclusive_runner.clear_exclusive_mode_for_this_thread();
     }
 
+    // enables in-memory cache of values for get()/find(), max_size_bytes is approximate as values are measured by their db size
+    void enable_cache(uint64_t max_size_bytes)
+    {
+      m_cache.reset(new cache_t(max_size_bytes));
+    }
+
+    bool get_cache_stats(cache_stats& stats) const
+    {
+      if (!m_cache)
+        return false;
+      stats = m_cache->get_stats();
+      return true;
+    }
+
     bool begin_transaction(bool read_only = false)
     {
       return m_dbb.begin_transaction(read_only);
@@ -480,14 +618,40 @@ namespace db
     void set(const key_t& key, const value_t& value)
     {
       m_cached_size_is_valid = false;
+      on_item_modified(key);
       value_type_helper_selector<value_type_is_serializable>::set(m_tid, m_dbb, key, value);
     }
 
     std::shared_ptr<const value_t> get(const key_t& key) const
     {
+      if (m_cache)
+        return get_through_cache(key);
       return value_type_helper_selector<value_type_is_serializable>::template get<key_t, value_t>(m_tid, m_dbb, key);
     }
 
+    // zero-copy access to the value bytes as they are stored in db: callback(const void* value_data, size_t value_size) -> bool
+    // is called within the read transaction, returns false if the key was not found or the callback returned false
+    template<class callback_t>
+    bool get_stored_and_visit(const key_t& key, callback_t callback) const
+    {
+      return m_dbb.get_and_visit(m_tid, key, callback);
+    }
+
+    // looks up all the keys within one read transaction using one db cursor, keys sorted in db key order give the best locality
+    // callback(i, value) is called for each found key, i is the key's position in keys
+    template<class callback_t>
+    void get_multiple(const std::vector<key_t>& keys, callback_t callback) const
+    {
+      bool r = m_dbb.get_multiple_and_visit(m_tid, keys, [&](size_t i, const void* value_data, size_t value_size) -> bool
+      {
+        value_t value = AUTO_VAL_INIT(value);
+        if (!value_type_helper_selector<value_type_is_serializable>::tvalue_from_pointer(value_data, value_size, value))
+          return false;
+        return callback(i, value);
+      });
+      CHECK_AND_ASSERT_THROW_MES(r, "get_multiple failed for " << keys.size() << " keys");
+    }
+
     std::shared_ptr<const value_t> find(const key_t& key) const
     {
       return get(key);
@@ -502,6 +666,7 @@ namespace db
     void explicit_set(const explicit_key_t& key, const explicit_value_t& value)
     {
       m_cached_size_is_valid = false;
+      on_item_modified(key);
       object_value_helper_t::set(m_tid, m_dbb, key, value);
     }
 
@@ -546,6 +711,8 @@ namespace db
     bool clear()
     {
       bool r = m_dbb.clear(m_tid);
+      if (m_cache)
+        m_cache->clear();
       m_exclusive_runner.run_exclusively<bool>([this](){
         m_cached_size_is_valid = false;
         return true;
@@ -556,6 +723,7 @@ namespace db
     bool erase_validate(const key_t& k)
     {
       auto res_ptr = this->get(k);
+      on_item_modified(k);
       m_dbb.erase(m_tid, k);
       m_exclusive_runner.run_exclusively<bool>([&](){
         m_cached_size_is_valid = false;
@@ -567,6 +735,7 @@ namespace db
 
     void erase(const key_t& k)
     {
+      on_item_modified(k);
       bool r = m_dbb.erase(m_tid, k);
       CHECK_AND_ASSERT_THROW_MES(r, "trying to erase a non-existing element");
       m_exclusive_runner.run_exclusively<bool>([&](){
@@ -588,8 +757,44 @@ namespace db
     epee::misc_utils::exclusive_access_helper m_exclusive_runner;
 
   private:
+    typedef sharded_lru_cache<key_t, value_t, tkey_hasher<key_t>, tkey_equal<key_t>> cache_t;
+
+    std::shared_ptr<const value_t> get_through_cache(const key_t& key) const
+    {
+      std::shared_ptr<const value_t> result;
+      uint64_t generation = 0;
+      if (m_cache->get(key, result, generation))
+        return result;
+
+      std::shared_ptr<value_t> value = std::make_shared<value_t>();
+      size_t value_size = 0;
+      bool r = m_dbb.get_and_visit(m_tid, key, [&](const void* value_data, size_t size) -> bool
+      {
+        value_size = size;
+        return value_type_helper_selector<value_type_is_serializable>::tvalue_from_pointer(value_data, size, *value);
+      });
+      if (!r)
+        return nullptr;
+
+      m_cache->put(key, value, value_size, generation);
+      return value;
+    }
+
+    void on_item_modified(const key_t& key)
+    {
+      if (m_cache)
+        m_cache->on_key_modified(key);
+    }
+
+    template<class other_key_t>
+    void on_item_modified(const other_key_t& key)
+    {
+      // keys of other types (see explicit_set) never get into the cache
+    }
+
     mutable size_t m_cached_size;
     mutable bool m_cached_size_is_valid;
+    std::unique_ptr<cache_t> m_cache;
   }; // class key_value_accessor_base
 
 
@@ -711,6 +916,41 @@ namespace db
       return super::get(ck);
     }
 
+    // vectorized get_subitem: result[k] is the item with index indices[k]
+    // the array size is read once, then items are read with one cursor in db key order rather than in the order of indices
+    void get_subitems(const array_key_t& array_key, const std::vector<size_t>& indices, std::vector<std::shared_ptr<const value_t>>& result) const
+    {
+      result.assign(indices.size(), std::shared_ptr<const value_t>());
+      if (indices.empty())
+        return;
+
+      // the size and the items should be read from the same snapshot
+      super::m_dbb.begin_transaction(true);
+      try
+      {
+        get_subitems_within_transaction(array_key, indices, result);
+      }
+      catch (...)
+      {
+        super::m_dbb.commit_transaction();
+        throw;
+      }
+      super::m_dbb.commit_transaction();
+    }
+
+    // items [from, to) of the array, see get_subitems above
+    void get_subitems(const array_key_t& array_key, size_t from, size_t to, std::vector<std::shared_ptr<const value_t>>& result) const
+    {
+      std::vector<size_t> indices;
+      if (to > from)
+      {
+        indices.reserve(to - from);
+        for (size_t i = from; i != to; ++i)
+          indices.push_back(i);
+      }
+      get_subitems(array_key, indices, result);
+    }
+
     void push_back_item(const array_key_t& array_key, const value_t& v)
     {
       auto counter = get_counter_accessor(array_key);
@@ -733,7 +973,46 @@ namespace db
       super::erase(ck);
     }
 
+    void set_subitem(const array_key_t& array_key, size_t i, const value_t& v)
+    {
+      size_t count = get_item_size(array_key);
+      CHECK_AND_ASSERT_THROW_MES(i < count, "array key " << array_key << ": index " << i << " out of bounds, size = " << count);
+      complex_key<array_key_t, size_t> ck{ array_key, i };
+      super::set(ck, v);
+    }
+
   private:
+    void get_subitems_within_transaction(const array_key_t& array_key, const std::vector<size_t>& indices, std::vector<std::shared_ptr<const value_t>>& result) const
+    {
+      size_t count = get_item_size(array_key);
+      std::vector<complex_key<array_key_t, size_t>> keys;
+      keys.reserve(indices.size());
+      for (size_t i : indices)
+      {
+        CHECK_AND_ASSERT_THROW_MES(i < count, "array key " << array_key << ": item index " << i << " exceeds elements count == " << count);
+        keys.push_back(complex_key<array_key_t, size_t>{ array_key, i });
+      }
+
+      // keys are compared bytewise by the db, so sort them the same way (it's not the order of indices as they're stored little-endian)
+      std::vector<size_t> order(keys.size());
+      for (size_t k = 0; k != order.size(); ++k)
+        order[k] = k;
+      std::sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return memcmp(&keys[a], &keys[b], sizeof keys[a]) < 0; });
+      std::vector<complex_key<array_key_t, size_t>> sorted_keys;
+      sorted_keys.reserve(keys.size());
+      for (size_t k : order)
+        sorted_keys.push_back(keys[k]);
+
+      super::get_multiple(sorted_keys, [&](size_t i, const value_t& v) -> bool
+      {
+        result[order[i]] = std::make_shared<const value_t>(v);
+        return true;
+      });
+
+      for (size_t k = 0; k != result.size(); ++k)
+        CHECK_AND_ASSERT_THROW_MES(result[k], "array key " << array_key << ": item with index " << indices[k] << " not found, elements count == " << count);
+    }
+
     const uuid128_key array_counter_suffix_key; // just a number to store array counter using complex_key
 
     single_value<complex_key<array_key_t, uuid128_key>, size_t, super> get_counter_accessor(const array_key_t& array_key)
@@ -853,6 +1132,7 @@ namespace db
 
     
   // naive cache for array 
+  // m_cache is guarded by m_cache_lock as const getters may be called concurrently by readers
   template<class value_t, bool value_type_is_serializable, int cache_default_limit>
   class cached_array_accessor : protected array_accessor<value_t, value_type_is_serializable>
   {
@@ -863,22 +1143,26 @@ namespace db
 
     uint64_t m_cache_size_limit;
     mutable std::map<size_t, std::shared_ptr<const value_t> > m_cache;
+    mutable epee::critical_section m_cache_lock;
 
     bool init(const std::string& table_name)
     {
+      CRITICAL_REGION_LOCAL(m_cache_lock);
       m_cache.clear();
       return super::init(table_name);
     }
 
     bool clear()
     {
-      return super::clear();
+      CRITICAL_REGION_LOCAL(m_cache_lock);
       m_cache.clear();
+      return super::clear();
     }
 
     void push_back(const value_t& v)
     {
       super::push_back(v);
+      CRITICAL_REGION_LOCAL(m_cache_lock);
       m_cache[super::size() - 1] = std::make_shared<const value_t>(v);
       crop_cache();
     }
@@ -886,6 +1170,7 @@ namespace db
     void pop_back()
     {
       super::pop_back();
+      CRITICAL_REGION_LOCAL(m_cache_lock);
       auto it = m_cache.find(super::size());
       if (it != m_cache.end())
         m_cache.erase(it);
@@ -896,6 +1181,8 @@ namespace db
       return super::size();
     }
 
+    using super::get_stored_and_visit;
+
     std::shared_ptr<const value_t> back() const
     {
       return this->operator [](size()-1);
@@ -908,6 +1195,7 @@ namespace db
 
       if (supposed_to_cache)
       {
+        CRITICAL_REGION_LOCAL(m_cache_lock);
         auto it = m_cache.find(k);
         if (it != m_cache.end())
           return it->second;
@@ -915,6 +1203,7 @@ namespace db
       auto res = super:: operator [](k);
       if (supposed_to_cache)
       {
+        CRITICAL_REGION_LOCAL(m_cache_lock);
         m_cache[k] = res;
       }
       return res;
@@ -4,10 +4,13 @@
 #include "db_lmdb_adapter.h"
 #include <thread>
 #include <mutex>
+#include <set>
 #include "misc_language.h"
 #include "db/liblmdb/lmdb.h"
 #include "common/util.h"
 #include "boost/thread/recursive_mutex.hpp"
+#include "boost/thread/mutex.hpp"
+#include "boost/thread/tss.hpp"
 #include "epee/include/misc_language.h"
 #include "epee/include/string_coding.h"
 #include "command_line.h"
@@ -25,38 +28,95 @@ namespace db
 
   struct stack_entry_t
   {
-    explicit stack_entry_t(MDB_txn* txn, bool ro_access) : txn(txn), ro_access(ro_access) {}
+    explicit stack_entry_t(MDB_txn* txn, bool ro_access, bool borrowed = false) : txn(txn), ro_access(ro_access), borrowed(borrowed) {}
     MDB_txn* txn;         // lmdb transaction handle
     bool     ro_access;   // if true: this db transaction is declared by user as Read-Only
+    bool     borrowed;    // if true: txn belongs to the parent entry (read-only access within already opened transaction)
+  };
+
+  struct thread_contexts_registry_t;
+
+  // per-thread state of the adapter, so the read path doesn't need any global lock
+  struct thread_context_t
+  {
+    thread_context_t(const std::shared_ptr<thread_contexts_registry_t>& registry) : p_read_txn(nullptr), registry(registry) {}
+    std::list<stack_entry_t> tx_stack; // (tx_entry, tx_entry, ...)
+    MDB_txn* p_read_txn;               // reset read-only txn kept for reuse via mdb_txn_renew, or nullptr
+    std::shared_ptr<thread_contexts_registry_t> registry;
+  };
+
+  // all thread contexts of an adapter, used by close() and on thread exit; may outlive the adapter
+  struct thread_contexts_registry_t
+  {
+    boost::mutex lock;
+    std::set<thread_context_t*> contexts;
   };
 
   struct lmdb_adapter_impl
   {
     lmdb_adapter_impl()
       : p_mdb_env(nullptr)
+      , m_registry(std::make_shared<thread_contexts_registry_t>())
+      , m_thread_context(&lmdb_adapter_impl::cleanup_thread_context)
       , m_db_flags_default(MDB_NORDAHEAD)
       , m_db_flags(m_db_flags_default)
     {}
 
-    MDB_txn* get_current_transaction() const
+    // called for each thread on its exit (or on adapter destruction for the current thread)
+    static void cleanup_thread_context(thread_context_t* ctx)
     {
-      std::lock_guard<boost::recursive_mutex> guard(m_transaction_stack_mutex);
-      auto it = m_transaction_stack.find(std::this_thread::get_id());
-      CHECK_AND_ASSERT_MES(it != m_transaction_stack.end(), nullptr, "m_transaction_stack is not found for thread id " << std::this_thread::get_id());
-      CHECK_AND_ASSERT_MES(!it->second.empty(), nullptr, "m_transaction_stack is empty for thread id " << std::this_thread::get_id());
-      return it->second.back().txn;
+      if (!ctx)
+        return;
+      {
+        std::lock_guard<boost::mutex> guard(ctx->registry->lock);
+        ctx->registry->contexts.erase(ctx);
+        if (ctx->p_read_txn != nullptr)
+          mdb_txn_abort(ctx->p_read_txn);
+      }
+      delete ctx;
     }
 
-    bool has_active_transaction() const
+    thread_context_t& get_thread_context()
     {
-      std::lock_guard<boost::recursive_mutex> guard(m_transaction_stack_mutex);
-      auto it = m_transaction_stack.find(std::this_thread::get_id());
-      return it != m_transaction_stack.end() && !it->second.empty();
+      thread_context_t* ctx = m_thread_context.get();
+      if (ctx != nullptr && ctx->registry == m_registry)
+        return *ctx;
+
+      // first call in this thread (or stale context left by another adapter which had the same address)
+      ctx = new thread_context_t(m_registry);
+      {
+        std::lock_guard<boost::mutex> guard(m_registry->lock);
+        m_registry->contexts.insert(ctx);
+      }
+      m_thread_context.reset(ctx);
+      return *ctx;
+    }
+
+    MDB_txn* get_current_transaction()
+    {
+      thread_context_t& ctx = get_thread_context();
+      CHECK_AND_ASSERT_MES(!ctx.tx_stack.empty(), nullptr, "transaction stack is empty for thread id " << std::this_thread::get_id());
+      return ctx.tx_stack.back().txn;
+    }
+
+    bool has_active_transaction()
+    {
+      return !get_thread_context().tx_stack.empty();
+    }
+
+    // keeps outermost read-only txn handle for reuse instead of freeing it
+    void release_read_transaction(thread_context_t& ctx, MDB_txn* txn)
+    {
+      mdb_txn_reset(txn);
+      if (ctx.p_read_txn == nullptr)
+        ctx.p_read_txn = txn;
+      else
+        mdb_txn_abort(txn);
     }
 
     MDB_env* p_mdb_env;
-    std::map<std::thread::id, std::list<stack_entry_t>> m_transaction_stack; // thread_id -> (tx_entry, tx_entry, ...)
-    mutable boost::recursive_mutex m_transaction_stack_mutex; // protects m_transaction_stack
+    std::shared_ptr<thread_contexts_registry_t> m_registry;
+    boost::thread_specific_ptr<thread_context_t> m_thread_context;
     mutable boost::recursive_mutex m_begin_commit_abort_mutex; // protects db transaction sequence
     const unsigned int m_db_flags_default;
     unsigned int m_db_flags;
@@ -137,12 +197,14 @@ namespace db
     if (m_p_impl->p_mdb_env)
     {
       {
-        std::lock_guard<boost::recursive_mutex> guard(m_p_impl->m_transaction_stack_mutex);
+        std::lock_guard<boost::mutex> guard(m_p_impl->m_registry->lock);
         bool unlock_begin_commit_abort_mutex = false;
-        for (auto& pair_id_tx_stack : m_p_impl->m_transaction_stack)
+        for (thread_context_t* ctx : m_p_impl->m_registry->contexts)
         {
-          for(auto& tx_stack : pair_id_tx_stack.second)
+          for(auto& tx_stack : ctx->tx_stack)
           {
+            if (tx_stack.borrowed)
+              continue;
             int result = mdb_txn_commit(tx_stack.txn);
             if (result != MDB_SUCCESS)
             {
@@ -151,10 +213,16 @@ namespace db
             if (!tx_stack.ro_access)
               unlock_begin_commit_abort_mutex = true;
           }
+          ctx->tx_stack.clear();
+          if (ctx->p_read_txn != nullptr)
+          {
+            mdb_txn_abort(ctx->p_read_txn);
+            ctx->p_read_txn = nullptr;
+          }
         }
         if (unlock_begin_commit_abort_mutex)
           m_p_impl->m_begin_commit_abort_mutex.lock();
-      } // lock_guard : m_p_impl->m_transaction_stack_mutex
+      } // lock_guard : m_p_impl->m_registry->lock
 
       mdb_env_close(m_p_impl->p_mdb_env);
       m_p_impl->p_mdb_env = nullptr;
@@ -189,7 +257,7 @@ namespace db
     if (!m_p_impl->has_active_transaction())
     {
       local_transaction = true;
-      begin_transaction();
+      begin_transaction(true);
     }
     int r = mdb_stat(m_p_impl->get_current_transaction(), static_cast<MDB_dbi>(tid), &table_stat);
     if (local_transaction)
@@ -203,22 +271,46 @@ namespace db
     if (!read_only_access)
       m_p_impl->m_begin_commit_abort_mutex.lock(); // lock db tx sequence guard only for write-enabled transactions
 
-    std::lock_guard<boost::recursive_mutex> guard(m_p_impl->m_transaction_stack_mutex);
-    std::list<stack_entry_t>& tx_stack = m_p_impl->m_transaction_stack[std::this_thread::get_id()]; // get or create empty list
+    thread_context_t& ctx = m_p_impl->get_thread_context();
+    std::list<stack_entry_t>& tx_stack = ctx.tx_stack;
 
     MDB_txn* p_parent_tx = nullptr;
     MDB_txn* p_new_tx = nullptr;
     if (!tx_stack.empty())
       p_parent_tx = tx_stack.back().txn;
 
+    if (read_only_access && p_parent_tx != nullptr)
+    {
+      // lmdb doesn't support read-only nested transactions, and there's no need in them: just reuse the parent's one
+      tx_stack.push_back(stack_entry_t(p_parent_tx, read_only_access, true));
+      return true;
+    }
+
     tx_stack.push_back(stack_entry_t(p_new_tx, read_only_access)); // new stack entry should be added in ANY case, don't return before this line
     auto& new_stack_entry = tx_stack.back();
 
-    unsigned int flags = read_only_access ? MDB_RDONLY : 0;
     // TODO: review the following check thorughly
     CHECK_AND_ASSERT_MES(m_p_impl != nullptr && m_p_impl->p_mdb_env != nullptr, false, "db env is null");
-    int r = mdb_txn_begin(m_p_impl->p_mdb_env, p_parent_tx, flags, &p_new_tx);
-    CHECK_DB_CALL_RESULT(r, false, "mdb_txn_begin");
+
+    if (read_only_access && ctx.p_read_txn != nullptr)
+    {
+      // reuse this thread's reader handle (and its reader table slot)
+      std::swap(p_new_tx, ctx.p_read_txn);
+      int r = mdb_txn_renew(p_new_tx);
+      if (r != MDB_SUCCESS)
+      {
+        LOG_PRINT_L1("mdb_txn_renew failed: " << mdb_strerror(r) << ", starting a new read transaction");
+        mdb_txn_abort(p_new_tx);
+        p_new_tx = nullptr;
+      }
+    }
+
+    if (p_new_tx == nullptr)
+    {
+      unsigned int flags = read_only_access ? MDB_RDONLY : 0;
+      int r = mdb_txn_begin(m_p_impl->p_mdb_env, p_parent_tx, flags, &p_new_tx);
+      CHECK_DB_CALL_RESULT(r, false, "mdb_txn_begin");
+    }
 
     new_stack_entry.txn = p_new_tx; // update stack entry with correct txn
 
@@ -234,21 +326,27 @@ namespace db
         m_p_impl->m_begin_commit_abort_mutex.unlock();
     });
 
-    std::lock_guard<boost::recursive_mutex> guard(m_p_impl->m_transaction_stack_mutex);
-    auto it = m_p_impl->m_transaction_stack.find(std::this_thread::get_id());
-    // TODO: consider changing the following two checks to CHECK_AND_ASSERT_THROW_MES
-    CHECK_AND_ASSERT_MES(it != m_p_impl->m_transaction_stack.end(), false, "m_transaction_stack is not found for thread id " << std::this_thread::get_id());
-    CHECK_AND_ASSERT_MES(!it->second.empty(), false, "m_transaction_stack is empty for thread id " << std::this_thread::get_id());
-    std::list<stack_entry_t>& tx_stack = it->second;
+    thread_context_t& ctx = m_p_impl->get_thread_context();
+    std::list<stack_entry_t>& tx_stack = ctx.tx_stack;
+    // TODO: consider changing the following check to CHECK_AND_ASSERT_THROW_MES
+    CHECK_AND_ASSERT_MES(!tx_stack.empty(), false, "transaction stack is empty for thread id " << std::this_thread::get_id());
 
     MDB_txn* txn = tx_stack.back().txn;
     read_only_access = tx_stack.back().ro_access; // set actual value for unlocker
+    bool borrowed = tx_stack.back().borrowed;
 
     tx_stack.pop_back();
-    if (tx_stack.empty())
-      m_p_impl->m_transaction_stack.erase(it);
-    // tx_stack could be invalid after this point 
-          
+
+    if (borrowed)
+      return true; // txn is owned by the parent entry
+
+    if (read_only_access && tx_stack.empty() && txn != nullptr)
+    {
+      // nothing to commit for a read-only txn, keep the handle for the next one
+      m_p_impl->release_read_transaction(ctx, txn);
+      return true;
+    }
+
     int r = 0;
     r = mdb_txn_commit(txn);
     CHECK_DB_CALL_RESULT(r, false, "mdb_txn_commit failed");
@@ -265,21 +363,26 @@ namespace db
         m_p_impl->m_begin_commit_abort_mutex.unlock();
     });
 
-    std::lock_guard<boost::recursive_mutex> guard(m_p_impl->m_transaction_stack_mutex);
-    auto it = m_p_impl->m_transaction_stack.find(std::this_thread::get_id());
-    // TODO: consider changing the following two checks to CHECK_AND_ASSERT_THROW_MES
-    CHECK_AND_ASSERT_MES_NO_RET(it != m_p_impl->m_transaction_stack.end(), "m_transaction_stack is not found for thread id " << std::this_thread::get_id());
-    CHECK_AND_ASSERT_MES_NO_RET(!it->second.empty(), "m_transaction_stack is empty for thread id " << std::this_thread::get_id());
-    std::list<stack_entry_t>& tx_stack = it->second;
+    thread_context_t& ctx = m_p_impl->get_thread_context();
+    std::list<stack_entry_t>& tx_stack = ctx.tx_stack;
+    // TODO: consider changing the following check to CHECK_AND_ASSERT_THROW_MES
+    CHECK_AND_ASSERT_MES_NO_RET(!tx_stack.empty(), "transaction stack is empty for thread id " << std::this_thread::get_id());
 
     MDB_txn* txn = tx_stack.back().txn;
     read_only_access = tx_stack.back().ro_access; // set actual value for unlocker
+    bool borrowed = tx_stack.back().borrowed;
 
     tx_stack.pop_back();
-    if (tx_stack.empty())
-      m_p_impl->m_transaction_stack.erase(it);
-    // tx_stack could be invalid after this point 
-          
+
+    if (borrowed)
+      return; // txn is owned by the parent entry
+
+    if (read_only_access && tx_stack.empty() && txn != nullptr)
+    {
+      m_p_impl->release_read_transaction(ctx, txn);
+      return;
+    }
+
     mdb_txn_abort(txn);
   }
   
@@ -309,6 +412,87 @@ namespace db
     return true;
   }
 
+  bool lmdb_adapter::get_and_visit(const table_id tid, const char* key_data, size_t key_size, i_db_visitor* visitor)
+  {
+    CHECK_AND_ASSERT_MES(visitor != nullptr, false, "visitor is null");
+    int r = 0;
+    MDB_val key = AUTO_VAL_INIT(key);
+    MDB_val data = AUTO_VAL_INIT(data);
+    key.mv_data = const_cast<char*>(key_data);
+    key.mv_size = key_size;
+
+    // data returned by mdb_get points into the memory map and stays valid until the end of the transaction,
+    // so the local transaction (if any) is kept open until the visitor is done
+    bool local_transaction = !m_p_impl->has_active_transaction();
+    if (local_transaction)
+      begin_transaction(true);
+
+    r = mdb_get(m_p_impl->get_current_transaction(), static_cast<MDB_dbi>(tid), &key, &data);
+
+    bool result = false;
+    if (r == MDB_SUCCESS)
+    {
+      try
+      {
+        result = visitor->on_visit_db_item(0, key.mv_data, key.mv_size, data.mv_data, data.mv_size);
+      }
+      catch (...)
+      {
+        if (local_transaction)
+          commit_transaction();
+        throw;
+      }
+    }
+
+    if (local_transaction)
+      commit_transaction();
+
+    if (r == MDB_NOTFOUND)
+      return false;
+
+    CHECK_DB_CALL_RESULT(r, false, "mdb_get failed");
+    return result;
+  }
+
+  bool lmdb_adapter::get_multiple_and_visit(const table_id tid, const char* keys_data, size_t key_size, size_t keys_count, i_db_visitor* visitor)
+  {
+    CHECK_AND_ASSERT_MES(visitor != nullptr, false, "visitor is null");
+    CHECK_AND_ASSERT_MES(keys_data != nullptr || keys_count == 0, false, "keys_data is null");
+
+    bool local_transaction = !m_p_impl->has_active_transaction();
+    if (local_transaction)
+      begin_transaction(true);
+    auto local_transaction_commiter = epee::misc_utils::create_scope_leave_handler([&](){
+      if (local_transaction)
+        commit_transaction();
+    });
+
+    MDB_cursor* p_cursor = nullptr;
+    int r = mdb_cursor_open(m_p_impl->get_current_transaction(), static_cast<MDB_dbi>(tid), &p_cursor);
+    CHECK_DB_CALL_RESULT(r, false, "mdb_cursor_open failed");
+    CHECK_AND_ASSERT_MES(p_cursor != nullptr, false, "p_cursor == nullptr");
+    auto cursor_closer = epee::misc_utils::create_scope_leave_handler([p_cursor](){ mdb_cursor_close(p_cursor); });
+
+    // positioned cursor stays on its leaf page if the next key belongs to it, so ordered keys don't cause a tree descent each
+    for (size_t i = 0; i != keys_count; ++i)
+    {
+      MDB_val key = AUTO_VAL_INIT(key);
+      MDB_val data = AUTO_VAL_INIT(data);
+      key.mv_data = const_cast<char*>(keys_data + i * key_size);
+      key.mv_size = key_size;
+
+      r = mdb_cursor_get(p_cursor, &key, &data, MDB_SET_KEY);
+      if (r == MDB_NOTFOUND)
+        continue;
+      CHECK_DB_CALL_RESULT(r, false, "mdb_cursor_get failed");
+
+      if (!visitor->on_visit_db_item(i, key.mv_data, key.mv_size, data.mv_data, data.mv_size))
+        return false;
+    }
+
+    return true;
+  }
+
   bool lmdb_adapter::set(const table_id tid, const char* key_data, size_t key_size, const char* value_data, size_t value_size)
   {
     int r = 0;
@@ -349,7 +533,7 @@ namespace db
     if (!m_p_impl->has_active_transaction())
     {
       local_transaction = true;
-      begin_transaction();
+      begin_transaction(true);
     }
     MDB_cursor* p_cursor = nullptr;
     int r = mdb_cursor_open(m_p_impl->get_current_transaction(), static_cast<MDB_dbi>(tid), &p_cursor);
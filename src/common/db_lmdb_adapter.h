@@ -28,6 +28,8 @@ namespace db
     virtual bool commit_transaction() override;
     virtual void abort_transaction() override;
     virtual bool get(const table_id tid, const char* key_data, size_t key_size, std::string& out_buffer) override;
+    virtual bool get_and_visit(const table_id tid, const char* key_data, size_t key_size, i_db_visitor* visitor) override;
+    virtual bool get_multiple_and_visit(const table_id tid, const char* keys_data, size_t key_size, size_t keys_count, i_db_visitor* visitor) override;
     virtual bool set(const table_id tid, const char* key_data, size_t key_size, const char* value_data, size_t value_size) override;
     virtual bool erase(const table_id tid, const char* key_data, size_t key_size) override;
     virtual bool visit_table(const table_id tid, i_db_visitor* visitor) override;
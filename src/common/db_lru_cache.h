@@ -0,0 +1,190 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+#pragma once
+
+#include <list>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+#include "misc_language.h"
+#include "syncobj.h"
+
+#define DB_LRU_CACHE_DEFAULT_SHARDS_COUNT   16
+#define DB_LRU_CACHE_ITEM_OVERHEAD          128   // approximate memory used by list and index nodes per item, bytes
+
+namespace db
+{
+  struct cache_stats
+  {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t items_count;
+    uint64_t size_bytes;
+    uint64_t max_size_bytes;
+  };
+
+  ////////////////////////////////////////////////////////////
+  // sharded_lru_cache
+  // Size-bounded (in bytes) LRU cache of immutable values, split into independently locked shards.
+  // Coherence with the db is maintained by the owner:
+  //  - on_key_modified() should be called for each key changed by a write transaction, before the change;
+  //    such keys are evicted and are not cached until the transaction ends;
+  //  - on_write_transaction_end() should be called after the write transaction is committed or aborted.
+  // Values read from the db are put() along with the generation obtained from get(), so a value read before
+  // a commit is never cached after it. Readers are expected not to keep a read transaction open across
+  // a write commit (blockchain_storage guarantees that by its reader/writer lock).
+  ////////////////////////////////////////////////////////////
+  template<class key_t, class value_t, class hasher_t, class key_equal_t>
+  class sharded_lru_cache
+  {
+  public:
+    typedef std::shared_ptr<const value_t> value_ptr_t;
+
+    explicit sharded_lru_cache(uint64_t max_size_bytes, size_t shards_count = DB_LRU_CACHE_DEFAULT_SHARDS_COUNT)
+      : m_shards(shards_count > 0 ? shards_count : 1)
+      , m_max_size_bytes(max_size_bytes)
+      , m_generation(0)
+    {
+      for (auto& s : m_shards)
+        s.max_size_bytes = m_max_size_bytes / m_shards.size();
+    }
+
+    // returns false on miss; generation should be passed to put() together with the value read from the db
+    bool get(const key_t& k, value_ptr_t& result, uint64_t& generation)
+    {
+      generation = m_generation;
+      shard& s = get_shard(k);
+      CRITICAL_REGION_LOCAL(s.lock);
+      auto it = s.index.find(k);
+      if (it == s.index.end())
+      {
+        ++s.misses;
+        return false;
+      }
+      s.items.splice(s.items.begin(), s.items, it->second); // most recently used goes first
+      result = it->second->value;
+      ++s.hits;
+      return true;
+    }
+
+    void put(const key_t& k, const value_ptr_t& v, size_t value_size_bytes, uint64_t generation)
+    {
+      shard& s = get_shard(k);
+      CRITICAL_REGION_LOCAL(s.lock);
+      if (generation != m_generation || s.modified_keys.count(k) != 0)
+        return; // the db has been changed since the value was read, or the key is being changed right now
+
+      uint64_t item_size = value_size_bytes + sizeof(key_t) + DB_LRU_CACHE_ITEM_OVERHEAD;
+      if (item_size > s.max_size_bytes)
+        return;
+
+      auto it = s.index.find(k);
+      if (it != s.index.end())
+        remove_item(s, it);
+
+      s.items.push_front(item{ k, v, item_size });
+      s.index.insert(std::make_pair(k, s.items.begin()));
+      s.size_bytes += item_size;
+
+      while (s.size_bytes > s.max_size_bytes)
+      {
+        remove_item(s, s.index.find(s.items.back().key));
+        ++s.evictions;
+      }
+    }
+
+    void on_key_modified(const key_t& k)
+    {
+      shard& s = get_shard(k);
+      CRITICAL_REGION_LOCAL(s.lock);
+      auto it = s.index.find(k);
+      if (it != s.index.end())
+        remove_item(s, it);
+      s.modified_keys.insert(k);
+    }
+
+    void on_write_transaction_end()
+    {
+      ++m_generation;
+      for (auto& s : m_shards)
+      {
+        CRITICAL_REGION_LOCAL(s.lock);
+        s.modified_keys.clear();
+      }
+    }
+
+    void clear()
+    {
+      ++m_generation;
+      for (auto& s : m_shards)
+      {
+        CRITICAL_REGION_LOCAL(s.lock);
+        s.items.clear();
+        s.index.clear();
+        s.size_bytes = 0;
+      }
+    }
+
+    cache_stats get_stats() const
+    {
+      cache_stats result = AUTO_VAL_INIT(result);
+      result.max_size_bytes = m_max_size_bytes;
+      for (auto& s : m_shards)
+      {
+        CRITICAL_REGION_LOCAL(s.lock);
+        result.hits += s.hits;
+        result.misses += s.misses;
+        result.evictions += s.evictions;
+        result.items_count += s.index.size();
+        result.size_bytes += s.size_bytes;
+      }
+      return result;
+    }
+
+  private:
+    struct item
+    {
+      key_t key;
+      value_ptr_t value;
+      uint64_t size_bytes;
+    };
+    typedef std::list<item> items_list_t;
+    typedef std::unordered_map<key_t, typename items_list_t::iterator, hasher_t, key_equal_t> index_t;
+
+    struct shard
+    {
+      shard() : size_bytes(0), max_size_bytes(0), hits(0), misses(0), evictions(0) {}
+
+      mutable epee::critical_section lock;
+      items_list_t items;                                             // most recently used first
+      index_t index;
+      std::unordered_set<key_t, hasher_t, key_equal_t> modified_keys; // changed by the ongoing write transaction
+      uint64_t size_bytes;
+      uint64_t max_size_bytes;
+      uint64_t hits;
+      uint64_t misses;
+      uint64_t evictions;
+    };
+
+    shard& get_shard(const key_t& k)
+    {
+      return m_shards[hasher_t()(k) % m_shards.size()];
+    }
+
+    void remove_item(shard& s, typename index_t::iterator it)
+    {
+      s.size_bytes -= it->second->size_bytes;
+      s.items.erase(it->second);
+      s.index.erase(it);
+    }
+
+    std::vector<shard> m_shards;
+    const uint64_t m_max_size_bytes;
+    std::atomic<uint64_t> m_generation;
+  };
+
+} // namespace db
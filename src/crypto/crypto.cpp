@@ -356,6 +356,67 @@ POP_WARNINGS
     sc_mulsub(&sig[sec_index].r, &sig[sec_index].c, &sec, &k);
   }
 
+  namespace {
+    // ring member ready for verification: precomputed odd multiples of the key and of its hash_to_ec() point
+    struct ring_member_precomp {
+      ge_dsmp pub;
+      ge_dsmp hp;
+    };
+
+    // Direct-mapped cache of precomputed ring members: outputs are picked as decoys for many rings,
+    // so the same keys are decompressed over and over otherwise. Allocated on first use.
+    class ring_member_precomp_cache {
+    public:
+      static const size_t slots_count = 4096;
+      static const size_t locks_count = 64;
+
+      bool get(const public_key &key, ring_member_precomp &res) {
+        init();
+        size_t i = slot_index(key);
+        lock_guard<mutex> lock(m_locks[i % locks_count]);
+        const slot &s = m_slots[i];
+        if (!s.used || s.key != key) {
+          return false;
+        }
+        res = s.pre;
+        return true;
+      }
+
+      void put(const public_key &key, const ring_member_precomp &pre) {
+        init();
+        size_t i = slot_index(key);
+        lock_guard<mutex> lock(m_locks[i % locks_count]);
+        slot &s = m_slots[i];
+        s.used = true;
+        s.key = key;
+        s.pre = pre;
+      }
+
+    private:
+      struct slot {
+        bool used;
+        public_key key;
+        ring_member_precomp pre;
+      };
+
+      void init() {
+        std::call_once(m_init_flag, [this]() { m_slots.resize(slots_count, slot()); });
+      }
+
+      static size_t slot_index(const public_key &key) {
+        uint64_t v;
+        memcpy(&v, std::addressof(key), sizeof v);
+        return static_cast<size_t>(v % slots_count);
+      }
+
+      std::once_flag m_init_flag;
+      mutex m_locks[locks_count];
+      vector<slot> m_slots;
+    };
+
+    ring_member_precomp_cache ring_members_cache;
+  }
+
   bool crypto_ops::check_ring_signature(const hash &prefix_hash, const key_image &image,
     const public_key *const *pubs, size_t pubs_count,
     const signature *sig) {
@@ -364,6 +425,10 @@ POP_WARNINGS
     ge_dsmp image_pre;
     ec_scalar sum, h;
     rs_comm *const buf = reinterpret_cast<rs_comm *>(alloca(rs_comm_size(pubs_count)));
+    // L and R points of all ring members are encoded at once, sharing one field inversion
+    ge_p2 *const points = reinterpret_cast<ge_p2 *>(alloca(2 * pubs_count * sizeof(ge_p2)));
+    fe *const points_tmp = reinterpret_cast<fe *>(alloca(2 * pubs_count * sizeof(fe)));
+    ring_member_precomp member_pre;
 #if !defined(NDEBUG)
     for (i = 0; i < pubs_count; i++) {
       assert(check_key(*pubs[i]));
@@ -376,21 +441,25 @@ POP_WARNINGS
     sc_0(&sum);
     buf->h = prefix_hash;
     for (i = 0; i < pubs_count; i++) {
-      ge_p2 tmp2;
-      ge_p3 tmp3;
       if (sc_check(&sig[i].c) != 0 || sc_check(&sig[i].r) != 0) {
         return false;
       }
-      if (ge_frombytes_vartime(&tmp3, &*pubs[i]) != 0) {
-        return false;
+      if (!ring_members_cache.get(*pubs[i], member_pre)) {
+        ge_p3 tmp3;
+        if (ge_frombytes_vartime(&tmp3, &*pubs[i]) != 0) {
+          return false;
+        }
+        ge_dsm_precomp(member_pre.pub, &tmp3);
+        hash_to_ec(*pubs[i], tmp3);
+        ge_dsm_precomp(member_pre.hp, &tmp3);
+        ring_members_cache.put(*pubs[i], member_pre);
       }
-      ge_double_scalarmult_base_vartime(&tmp2, &sig[i].c, &tmp3, &sig[i].r);
-      ge_tobytes(&buf->ab[i].a, &tmp2);
-      hash_to_ec(*pubs[i], tmp3);
-      ge_double_scalarmult_precomp_vartime(&tmp2, &sig[i].r, &tmp3, &sig[i].c, image_pre);
-      ge_tobytes(&buf->ab[i].b, &tmp2);
+      ge_double_scalarmult_base_precomp_vartime(&points[2 * i], &sig[i].c, member_pre.pub, &sig[i].r);
+      ge_double_scalarmult_precomp2_vartime(&points[2 * i + 1], &sig[i].r, member_pre.hp, &sig[i].c, image_pre);
       sc_add(&sum, &sum, &sig[i].c);
     }
+    static_assert(sizeof(rs_comm::point) == 2 * 32, "Invalid structure size");
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char *>(buf->ab), points, 2 * pubs_count, points_tmp);
     hash_to_scalar(buf, rs_comm_size(pubs_count), h);
     sc_sub(&h, &h, &sum);
     return sc_isnonzero(&h) == 0;
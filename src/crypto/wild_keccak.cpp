@@ -9,6 +9,13 @@
 
 
 #include "wild_keccak.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define WILD_KECCAK_X4_AVX2
+#define WILD_KECCAK_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
 namespace crypto
 {
 
@@ -116,4 +123,222 @@ namespace crypto
       st[0] ^= keccakf_rndc[round];
     }
   }
-}
\ No newline at end of file
+
+  namespace
+  {
+    // lanes states are interleaved: st[i * lanes_count + lane], so that 4 lanes of a word are one AVX2 vector
+    template<size_t lanes_count>
+    struct lanes_state
+    {
+      uint64_t st[25 * lanes_count];
+    };
+
+    template<size_t lanes_count>
+    void mul_keccakf_lanes(uint64_t* st)
+    {
+      for (size_t lane = 0; lane != lanes_count; lane++)
+      {
+        uint64_t lane_st[25];
+        for (size_t i = 0; i != 25; i++)
+          lane_st[i] = st[i * lanes_count + lane];
+        mul_f::keccakf(lane_st, 1);
+        for (size_t i = 0; i != 25; i++)
+          st[i * lanes_count + lane] = lane_st[i];
+      }
+    }
+
+#ifdef WILD_KECCAK_X4_AVX2
+    WILD_KECCAK_TARGET_AVX2 inline __m256i mul64_x4(__m256i a, __m256i b)
+    {
+      // low 64 bits of a * b: a_lo * b_lo + ((a_hi * b_lo + a_lo * b_hi) << 32)
+      __m256i lo = _mm256_mul_epu32(a, b);
+      __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), b), _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+      return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+    }
+
+    WILD_KECCAK_TARGET_AVX2 inline __m256i rotl64_x4(__m256i x, int n)
+    {
+      return _mm256_or_si256(_mm256_sll_epi64(x, _mm_cvtsi32_si128(n)), _mm256_srl_epi64(x, _mm_cvtsi32_si128(64 - n)));
+    }
+
+    // mul_f::keccakf(st, 1) for 4 lanes, which are 4 adjacent words with the given stride
+    WILD_KECCAK_TARGET_AVX2 void mul_keccakf_x4(uint64_t* st, size_t stride)
+    {
+      __m256i a[25], bc[5], t;
+      for (size_t i = 0; i != 25; i++)
+        a[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(st + i * stride));
+
+      // Theta
+      for (size_t i = 0; i != 5; i++)
+        bc[i] = _mm256_xor_si256(_mm256_xor_si256(a[i], a[i + 5]), mul64_x4(mul64_x4(a[i + 10], a[i + 15]), a[i + 20]));
+
+      for (size_t i = 0; i != 5; i++)
+      {
+        t = _mm256_xor_si256(bc[(i + 4) % 5], rotl64_x4(bc[(i + 1) % 5], 1));
+        for (size_t j = 0; j != 25; j += 5)
+          a[j + i] = _mm256_xor_si256(a[j + i], t);
+      }
+
+      // Rho Pi
+      t = a[1];
+      for (size_t i = 0; i != 24; i++)
+      {
+        int j = keccakf_piln[i];
+        bc[0] = a[j];
+        a[j] = rotl64_x4(t, keccakf_rotc[i]);
+        t = bc[0];
+      }
+
+      //  Chi
+      for (size_t j = 0; j != 25; j += 5)
+      {
+        for (size_t i = 0; i != 5; i++)
+          bc[i] = a[j + i];
+        for (size_t i = 0; i != 5; i++)
+          a[j + i] = _mm256_xor_si256(a[j + i], _mm256_andnot_si256(bc[(i + 1) % 5], bc[(i + 2) % 5]));
+      }
+
+      //  Iota
+      a[0] = _mm256_xor_si256(a[0], _mm256_set1_epi64x(static_cast<long long>(keccakf_rndc[0])));
+
+      for (size_t i = 0; i != 25; i++)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(st + i * stride), a[i]);
+    }
+
+    bool detect_avx2()
+    {
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("avx2") != 0;
+    }
+#endif
+
+    template<size_t lanes_count>
+    void permute_lanes(uint64_t* st, bool use_x4)
+    {
+#ifdef WILD_KECCAK_X4_AVX2
+      if (use_x4 && lanes_count % 4 == 0)
+      {
+        for (size_t group = 0; group != lanes_count / 4; group++)
+          mul_keccakf_x4(st + group * 4, lanes_count);
+        return;
+      }
+#endif
+      mul_keccakf_lanes<lanes_count>(st);
+    }
+
+    // one wild_keccak absorbing step (xor of the block and 24 rounds with scratchpad mixing) for every lane
+    template<size_t lanes_count>
+    void absorb_lanes(lanes_state<lanes_count>& s, const uint8_t* const* pblocks, size_t rsizw, const scratchpad_mixer& mixer, bool use_x4)
+    {
+      for (size_t lane = 0; lane != lanes_count; lane++)
+      {
+        for (size_t i = 0; i != rsizw; i++)
+        {
+          uint64_t w;
+          memcpy(&w, pblocks[lane] + i * 8, sizeof(w));
+          s.st[i * lanes_count + lane] ^= w;
+        }
+      }
+
+      for (size_t ll = 0; ll != KECCAK_ROUNDS; ll++)
+      {
+        if (ll != 0)
+        {//skip first round
+          const hash* pitems[lanes_count][KK_MIXIN_SIZE];
+          for (size_t lane = 0; lane != lanes_count; lane++)
+          {
+            for (size_t k = 0; k != KK_MIXIN_SIZE; k++)
+            {
+              pitems[lane][k] = mixer.get_item(s.st[k * lanes_count + lane]);
+              scratchpad_mixer::prefetch(pitems[lane][k]);
+            }
+          }
+          for (size_t lane = 0; lane != lanes_count; lane++)
+          {
+            mixin_t mix_in;
+            for (size_t k = 0; k != KK_MIXIN_SIZE / 4; k++)
+              scratchpad_mixer::xor_4(&pitems[lane][k * 4], &mix_in[k * 4]);
+            for (size_t k = 0; k != KK_MIXIN_SIZE; k++)
+              s.st[k * lanes_count + lane] ^= mix_in[k];
+          }
+        }
+        permute_lanes<lanes_count>(s.st, use_x4);
+      }
+    }
+
+    template<size_t lanes_count>
+    void wild_keccak_lanes(const uint8_t* const* pin, size_t inlen, hash* pmd, const scratchpad_mixer& mixer, bool use_x4)
+    {
+      const size_t rsiz = 200 - 2 * sizeof(hash);
+      const size_t rsizw = rsiz / 8;
+      lanes_state<lanes_count> s;
+      memset(&s, 0, sizeof(s));
+
+      const uint8_t* pblocks[lanes_count];
+      size_t offset = 0;
+      for ( ; inlen >= rsiz; inlen -= rsiz, offset += rsiz)
+      {
+        for (size_t lane = 0; lane != lanes_count; lane++)
+          pblocks[lane] = pin[lane] + offset;
+        absorb_lanes(s, pblocks, rsizw, mixer, use_x4);
+      }
+
+      // last block and padding
+      uint8_t temp[lanes_count][144];
+      for (size_t lane = 0; lane != lanes_count; lane++)
+      {
+        memcpy(temp[lane], pin[lane] + offset, inlen);
+        temp[lane][inlen] = 1;
+        memset(temp[lane] + inlen + 1, 0, rsiz - inlen - 1);
+        temp[lane][rsiz - 1] |= 0x80;
+        pblocks[lane] = temp[lane];
+      }
+      absorb_lanes(s, pblocks, rsizw, mixer, use_x4);
+
+      for (size_t lane = 0; lane != lanes_count; lane++)
+      {
+        for (size_t i = 0; i != sizeof(hash) / 8; i++)
+          memcpy(reinterpret_cast<uint8_t*>(&pmd[lane]) + i * 8, &s.st[i * lanes_count + lane], 8);
+      }
+    }
+
+    template<size_t lanes_count>
+    void wild_keccak_dbl_lanes_impl(const uint8_t* const* pin, size_t inlen, hash* pmd, const scratchpad_mixer& mixer)
+    {
+      static const bool use_x4 = is_wild_keccak_x4_available();
+      //Satoshi's classic
+      wild_keccak_lanes<lanes_count>(pin, inlen, pmd, mixer, use_x4);
+      const uint8_t* pmd_in[lanes_count];
+      for (size_t lane = 0; lane != lanes_count; lane++)
+        pmd_in[lane] = reinterpret_cast<const uint8_t*>(&pmd[lane]);
+      wild_keccak_lanes<lanes_count>(pmd_in, sizeof(hash), pmd, mixer, use_x4);
+    }
+  }
+
+  bool is_wild_keccak_x4_available()
+  {
+#ifdef WILD_KECCAK_X4_AVX2
+    static const bool avx2 = detect_avx2();
+    return avx2;
+#else
+    return false;
+#endif
+  }
+
+  size_t get_wild_keccak_default_lanes_count()
+  {
+    return is_wild_keccak_x4_available() ? 8 : 4;
+  }
+
+  bool wild_keccak_dbl_lanes(const uint8_t* const* pin, size_t inlen, hash* pmd, size_t lanes_count, const scratchpad_mixer& mixer)
+  {
+    switch (lanes_count)
+    {
+    case 1: wild_keccak_dbl_lanes_impl<1>(pin, inlen, pmd, mixer); return true;
+    case 2: wild_keccak_dbl_lanes_impl<2>(pin, inlen, pmd, mixer); return true;
+    case 4: wild_keccak_dbl_lanes_impl<4>(pin, inlen, pmd, mixer); return true;
+    case 8: wild_keccak_dbl_lanes_impl<8>(pin, inlen, pmd, mixer); return true;
+    default: return false;
+    }
+  }
+}
@@ -12,6 +12,14 @@
 #include <string.h>
 #include "crypto.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WILD_KECCAK_MIX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WILD_KECCAK_MIX_SSE2
+#endif
+
 extern "C" {
 #include "crypto/alt/KeccakNISTInterface.h"
   }
@@ -178,6 +186,100 @@ inline
     return 0;
   }
 
+  // x % d for a fixed non-zero d without division: q = hi64(x * floor((2^64 - 1) / d)) is at most 2 less than x / d
+  class fast_mod64
+  {
+  public:
+    fast_mod64(uint64_t d = 1) { init(d); }
+
+    void init(uint64_t d)
+    {
+      m_d = d;
+      m_m = d ? UINT64_MAX / d : 0;
+    }
+
+    uint64_t mod(uint64_t x) const
+    {
+#if defined(__SIZEOF_INT128__)
+      uint64_t q = static_cast<uint64_t>((static_cast<unsigned __int128>(x) * m_m) >> 64);
+      uint64_t r = x - q * m_d;
+      // two corrections at most, kept branchless: their count is random for hashed input
+      r -= r >= m_d ? m_d : 0;
+      r -= r >= m_d ? m_d : 0;
+      return r;
+#else
+      return x % m_d;
+#endif
+    }
+
+  private:
+    uint64_t m_d;
+    uint64_t m_m;
+  };
+
+  // wild_keccak callback for a scratchpad kept as a plain array: same result as
+  // XOR_4(scr[st[i] % size], ...) per mixin hash, but all 24 lines of the round are
+  // prefetched before the first one is read
+  class scratchpad_mixer
+  {
+  public:
+    scratchpad_mixer(const hash* pscratchpad, uint64_t size) : m_pscratchpad(pscratchpad), m_size(size)
+    {}
+
+    void operator()(state_t_m& st, mixin_t& mix) const
+    {
+      const hash* pitems[KK_MIXIN_SIZE];
+      for (size_t i = 0; i != KK_MIXIN_SIZE; i++)
+      {
+        pitems[i] = get_item(st[i]);
+        prefetch(pitems[i]);
+      }
+      for (size_t i = 0; i != KK_MIXIN_SIZE / 4; i++)
+        xor_4(pitems + i * 4, &mix[i * 4]);
+    }
+
+    const hash* get_item(uint64_t index) const
+    {
+      return m_pscratchpad + m_size.mod(index);
+    }
+
+    static void prefetch(const hash* p)
+    {
+#if defined(WILD_KECCAK_MIX_AVX2) || defined(WILD_KECCAK_MIX_SSE2)
+      _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0);
+#elif defined(__GNUC__)
+      __builtin_prefetch(p);
+#endif
+    }
+
+    // pres = XOR_4() of the given four items
+    static void xor_4(const hash* const* pitems, uint64_t* pres)
+    {
+#if defined(WILD_KECCAK_MIX_AVX2)
+      __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pitems[0]));
+      r = _mm256_xor_si256(r, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pitems[1])));
+      r = _mm256_xor_si256(r, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pitems[2])));
+      r = _mm256_xor_si256(r, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pitems[3])));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(pres), r);
+#elif defined(WILD_KECCAK_MIX_SSE2)
+      for (size_t half = 0; half != 2; half++)
+      {
+        __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pitems[0]) + half);
+        r = _mm_xor_si128(r, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pitems[1]) + half));
+        r = _mm_xor_si128(r, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pitems[2]) + half));
+        r = _mm_xor_si128(r, _mm_loadu_si128(reinterpret_cast<const __m128i*>(pitems[3]) + half));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pres) + half, r);
+      }
+#else
+      *reinterpret_cast<hash*>(pres) = XOR_4(*pitems[0], *pitems[1], *pitems[2], *pitems[3]);
+#endif
+    }
+
+  private:
+    const hash* m_pscratchpad;
+    fast_mod64 m_size;
+  };
+
   class regular_f
   {
   public:
@@ -189,5 +291,12 @@ inline
   public:
     static void keccakf(uint64_t st[25], int rounds);
   };
+
+  // Interleaved hashing: wild_keccak_dbl<mul_f>() with scratchpad_mixer for lanes_count blobs of the same size,
+  // advanced round by round in lockstep, so the scratchpad reads of every lane are in flight together.
+  // lanes_count is 1, 2, 4 or 8; when the cpu has AVX2, the permutation is done for 4 lanes at once.
+  bool wild_keccak_dbl_lanes(const uint8_t* const* pin, size_t inlen, hash* pmd, size_t lanes_count, const scratchpad_mixer& mixer);
+  bool is_wild_keccak_x4_available();
+  size_t get_wild_keccak_default_lanes_count();
 }
 
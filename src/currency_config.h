@@ -62,13 +62,26 @@
 
 #define BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT          10000  //by default, blocks ids count in synchronizing
 #define BLOCKS_SYNCHRONIZING_DEFAULT_COUNT              200    //by default, blocks count in blocks downloading
+#define BLOCKS_SYNCHRONIZING_REQUESTS_PER_CONNECTION    2      //blocks requests kept in flight on each synchronizing connection
+#define BLOCKS_SYNCHRONIZING_MAX_BUFFERED_SPANS         20     //downloaded ahead spans of BLOCKS_SYNCHRONIZING_DEFAULT_COUNT blocks, waiting to be applied
+#define BLOCKS_SYNCHRONIZING_REQUEST_TIMEOUT            120    //seconds, then the blocks request is given to another connection
+#define BLOCKS_SYNCHRONIZING_MAX_PREVALIDATED_SPANS     4      //spans parsed and checked ahead of the applying thread
 #define CURRENCY_PROTOCOL_HOP_RELAX_COUNT               3      //value of hop, after which we use only announce of new block
+#define CURRENCY_PROTOCOL_MAX_TXS_REQUEST_COUNT         500    //transactions of one compact block requested at once
+#define CURRENCY_PROTOCOL_TX_RELAY_INTERVAL             250    //ms, transactions announcements to a connection are batched within
+#define CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT        1000   //transactions ids in one announcement or request
+#define CURRENCY_PROTOCOL_TX_KNOWN_FILTER_SIZE          20000  //transactions ids remembered as known by each connection
+#define CURRENCY_PROTOCOL_TX_REQUEST_TIMEOUT            30     //seconds, then an announced transaction could be requested again
 
 
 #define CURRENCY_ALT_BLOCK_LIVETIME_COUNT               (720*7)//one week
 #define CURRENCY_MEMPOOL_TX_LIVETIME                    86400 //seconds, one day
 #define CURRENCY_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME     (CURRENCY_ALT_BLOCK_LIVETIME_COUNT*DIFFICULTY_TARGET) //seconds, one week
 
+#define CURRENCY_DB_TRANSACTIONS_CACHE_SIZE             (64*1024*1024) //bytes, approximately
+#define CURRENCY_DB_BLOCKS_INDEX_CACHE_SIZE             (8*1024*1024)  //bytes, approximately
+#define CURRENCY_DB_SPENT_KEYS_CACHE_SIZE               (8*1024*1024)  //bytes, approximately
+
 
 #ifndef TESTNET
 #define P2P_DEFAULT_PORT                                10101
@@ -136,6 +149,7 @@
 //#define CURRENCY_BLOCKCHAINDATA_TEMP_FILENAME           "blockchain.bin.tmp"
 #define CURRENCY_BLOCKCHAINDATA_FOLDERNAME              "blockchain"
 #define CURRENCY_BLOCKCHAINDATA_SCRATCHPAD_CACHE        "scratchpad.cache"
+#define CURRENCY_SCRATCHPAD_SNAPSHOT_PAGE_SIZE          (1024 * 1024)  //bytes, scratchpad snapshot is kept and sent by parts of this size
 #define P2P_NET_DATA_FILENAME                           "p2pstate.bin"
 #define MINER_CONFIG_FILENAME                           "miner_conf.json"
 #define GUI_CONFIG_FILENAME                             "gui_conf.json"
@@ -0,0 +1,292 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <algorithm>
+#include "include_base_utils.h"
+#include "block_download_scheduler.h"
+
+namespace currency
+{
+  //-----------------------------------------------------------------------------------------------
+  block_download_scheduler::block_download_scheduler(size_t span_size, size_t max_requests_per_connection, size_t max_window_spans, time_t request_timeout)
+    : m_span_size(span_size)
+    , m_max_requests_per_connection(max_requests_per_connection)
+    , m_max_window_spans(max_window_spans)
+    , m_request_timeout(request_timeout)
+    , m_end_height(0)
+    , m_last_id(null_hash)
+    , m_applying_count(0)
+    , m_chain_requested(false)
+    , m_chain_request_time(0)
+    , m_stop(false)
+    , m_requests_count(0)
+    , m_generation(0)
+  {}
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::add_chain(uint64_t start_height, const std::list<crypto::hash>& ids)
+  {
+    if (continue_chain(ids))
+      return true;
+
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (ids.empty() || m_spans.size() || m_applying_count)
+      return false;
+
+    m_end_height = start_height;
+    add_ids(ids.begin(), ids.end());
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::continue_chain(const std::list<crypto::hash>& ids)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (!m_spans.size() && !m_applying_count)
+      return false;
+
+    // any chain response ends the request in flight, even if it doesn't continue the chain
+    m_chain_requested = false;
+    auto it = std::find(ids.begin(), ids.end(), m_last_id);
+    if (it == ids.end())
+      return false;
+
+    add_ids(++it, ids.end());
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::start_chain_request(uint64_t remote_height, crypto::hash& last_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if ((!m_spans.size() && !m_applying_count) || m_end_height >= remote_height)
+      return false;
+    if (m_chain_requested && time(nullptr) - m_chain_request_time < m_request_timeout)
+      return false;
+
+    m_chain_requested = true;
+    m_chain_request_time = time(nullptr);
+    last_id = m_last_id;
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::add_ids(std::list<crypto::hash>::const_iterator it, std::list<crypto::hash>::const_iterator end)
+  {
+    for (; it != end; ++it, ++m_end_height)
+    {
+      // the last span is topped up while nobody has requested it yet
+      span* ps = nullptr;
+      if (m_spans.size())
+      {
+        span& last = m_spans.rbegin()->second;
+        if (last.ids.size() < m_span_size && !last.requested && !last.received)
+          ps = &last;
+      }
+      if (!ps)
+      {
+        ps = &m_spans[m_end_height];
+        ps->start_height = m_end_height;
+        ps->connection_id = boost::uuids::uuid();
+        ps->remote_ip = 0;
+        ps->request_time = 0;
+        ps->request_number = 0;
+        ps->generation = 0;
+        ps->requested = false;
+        ps->received = false;
+      }
+      ps->ids.push_back(*it);
+      m_last_id = *it;
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  size_t block_download_scheduler::get_spans_to_request(const boost::uuids::uuid& connection_id, uint32_t remote_ip, uint64_t remote_height, std::list<std::list<crypto::hash> >& requests)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    size_t requests_count = 0;
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.requested && sp.second.connection_id == connection_id)
+        ++requests_count;
+    }
+
+    // only spans within the window are requested, so the buffer of downloaded spans waiting for the lower ones stays bounded
+    size_t i = 0;
+    for (auto it = m_spans.begin(); it != m_spans.end() && i != m_max_window_spans && requests_count < m_max_requests_per_connection; ++it, ++i)
+    {
+      span& s = it->second;
+      if (s.requested || s.received || s.start_height + s.ids.size() > remote_height)
+        continue;
+      s.requested = true;
+      s.connection_id = connection_id;
+      s.remote_ip = remote_ip;
+      s.request_time = time(nullptr);
+      s.request_number = m_requests_count++;
+      requests.push_back(s.ids);
+      ++requests_count;
+    }
+    return requests_count;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::on_span_received(const boost::uuids::uuid& connection_id, std::list<block_complete_entry>& blocks)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    // requests taken back are older than any request in flight, so they are answered first
+    auto it = m_forgotten_requests.find(connection_id);
+    if (it != m_forgotten_requests.end())
+    {
+      if (!--it->second)
+        m_forgotten_requests.erase(it);
+      LOG_PRINT_L1("Response to a withdrawn blocks request ignored, " << blocks.size() << " blocks");
+      return true;
+    }
+
+    span* ps = nullptr;
+    for (auto& sp : m_spans)
+    {
+      span& s = sp.second;
+      if (s.requested && s.connection_id == connection_id && (!ps || s.request_number < ps->request_number))
+        ps = &s;
+    }
+    if (!ps || ps->ids.size() != blocks.size())
+      return false;
+
+    ps->requested = false;
+    ps->received = true;
+    ps->blocks.swap(blocks);
+    lock.unlock();
+    m_span_received.notify_all();
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  size_t block_download_scheduler::on_connection_closed(const boost::uuids::uuid& connection_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    size_t count = 0;
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.requested && sp.second.connection_id == connection_id)
+      {
+        sp.second.requested = false;
+        ++count;
+      }
+    }
+    m_forgotten_requests.erase(connection_id);
+    return count;
+  }
+  //-----------------------------------------------------------------------------------------------
+  size_t block_download_scheduler::check_timeouts()
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    size_t count = 0;
+    time_t now = time(nullptr);
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.requested && now - sp.second.request_time >= m_request_timeout)
+      {
+        forget_request(sp.second);
+        ++count;
+      }
+    }
+    return count;
+  }
+  //-----------------------------------------------------------------------------------------------
+  size_t block_download_scheduler::get_requests_count(const boost::uuids::uuid& connection_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    size_t count = 0;
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.requested && sp.second.connection_id == connection_id)
+        ++count;
+    }
+    return count;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::wait_next_span(span& s)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    while (!m_stop && !(m_spans.size() && m_spans.begin()->second.received))
+      m_span_received.wait(lock);
+    if (m_stop)
+      return false;
+
+    s = std::move(m_spans.begin()->second);
+    s.generation = m_generation;
+    m_spans.erase(m_spans.begin());
+    ++m_applying_count;
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::on_span_applied(const span& s)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (s.generation != m_generation)
+      return;
+    if (m_applying_count)
+      --m_applying_count;
+    if (!m_spans.size() && !m_applying_count)
+      clear();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::is_outdated(const span& s)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    return s.generation != m_generation;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::reset()
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.requested)
+        forget_request(sp.second);
+    }
+    m_spans.clear();
+    m_applying_count = 0;
+    ++m_generation;
+    clear();
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::stop()
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      m_stop = true;
+    }
+    m_span_received.notify_all();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_download_scheduler::is_active()
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    return m_spans.size() || m_applying_count;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::get_stats(size_t& queued, size_t& requested, size_t& received)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    queued = requested = received = 0;
+    for (auto& sp : m_spans)
+    {
+      if (sp.second.received)
+        ++received;
+      else if (sp.second.requested)
+        ++requested;
+      else
+        ++queued;
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::forget_request(span& s)
+  {
+    s.requested = false;
+    ++m_forgotten_requests[s.connection_id];
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_download_scheduler::clear()
+  {
+    m_end_height = 0;
+    m_last_id = null_hash;
+    m_chain_requested = false;
+    m_chain_request_time = 0;
+  }
+}
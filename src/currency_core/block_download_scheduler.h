@@ -0,0 +1,97 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <map>
+#include <list>
+#include <boost/thread.hpp>
+#include <boost/uuid/uuid.hpp>
+#include "crypto/hash.h"
+#include "currency_basic.h"
+#include "currency_protocol/currency_protocol_defs.h"
+
+namespace currency
+{
+  /************************************************************************/
+  /* Splits ids of the blocks to download into spans and hands them out   */
+  /* to several connections at once. Downloaded spans are buffered within */
+  /* a bounded window and given to the applying thread in height order.   */
+  /************************************************************************/
+  class block_download_scheduler
+  {
+  public:
+    struct span
+    {
+      uint64_t start_height;
+      std::list<crypto::hash> ids;
+      std::list<block_complete_entry> blocks;
+      boost::uuids::uuid connection_id; // the connection the span is requested from, or was received from
+      uint32_t remote_ip;
+      time_t request_time;
+      uint64_t request_number;                    // responses of a connection come in the order of requests
+      uint64_t generation;                        // reset() makes spans taken before it outdated
+      bool requested;
+      bool received;
+    };
+
+    block_download_scheduler(size_t span_size, size_t max_requests_per_connection, size_t max_window_spans, time_t request_timeout);
+
+    // ids are the blocks we don't have, the first one is at start_height; if a chain is already scheduled, ids are
+    // taken only if they continue it (see continue_chain)
+    bool add_chain(uint64_t start_height, const std::list<crypto::hash>& ids);
+    // appends ids following the last scheduled one, false if there is no scheduled chain or ids don't contain its last id
+    bool continue_chain(const std::list<crypto::hash>& ids);
+    // true if the continuation of the scheduled chain is to be requested from a connection with remote_height blocks:
+    // there is a chain, the connection has blocks beyond it and no other request is in flight
+    bool start_chain_request(uint64_t remote_height, crypto::hash& last_id);
+
+    // marks spans the connection is able to give (limited by remote_height) as requested from it and puts their ids to requests
+    // returns the number of spans being downloaded from the connection, new ones included
+    size_t get_spans_to_request(const boost::uuids::uuid& connection_id, uint32_t remote_ip, uint64_t remote_height, std::list<std::list<crypto::hash> >& requests);
+    // blocks are the response to the oldest request of the connection, false if there is no such request or blocks count
+    // doesn't match; late responses to requests which were taken back (timeout, reset) are silently ignored
+    // blocks ids are not checked here, it is up to the consumer of the span
+    bool on_span_received(const boost::uuids::uuid& connection_id, std::list<block_complete_entry>& blocks);
+    // spans requested from the connection go back to the queue, returns their count
+    size_t on_connection_closed(const boost::uuids::uuid& connection_id);
+    // requests older than request_timeout go back to the queue, returns their count
+    size_t check_timeouts();
+    size_t get_requests_count(const boost::uuids::uuid& connection_id);
+
+    // waits until the lowest span is downloaded and takes it out, false on stop
+    bool wait_next_span(span& s);
+    // to be called for every span taken out, even outdated one
+    void on_span_applied(const span& s);
+    bool is_outdated(const span& s);
+    // forgets everything scheduled, used when a span failed to apply
+    void reset();
+    void stop();
+    bool is_active();
+    void get_stats(size_t& queued, size_t& requested, size_t& received);
+
+  private:
+    void add_ids(std::list<crypto::hash>::const_iterator it, std::list<crypto::hash>::const_iterator end);
+    void forget_request(span& s);
+    void clear();
+
+    const size_t m_span_size;
+    const size_t m_max_requests_per_connection;
+    const size_t m_max_window_spans;
+    const time_t m_request_timeout;
+
+    boost::mutex m_lock;
+    boost::condition_variable m_span_received;
+    std::map<uint64_t, span> m_spans;             // start height -> span, not applied yet
+    std::map<boost::uuids::uuid, size_t> m_forgotten_requests; // connection id -> requests whose responses are to be ignored
+    uint64_t m_requests_count;
+    uint64_t m_generation;
+    uint64_t m_end_height;                        // height next to the last scheduled block
+    crypto::hash m_last_id;
+    size_t m_applying_count;
+    bool m_chain_requested;
+    time_t m_chain_request_time;
+    bool m_stop;
+  };
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "include_base_utils.h"
+#include "profile_tools.h"
+#include "currency_format_utils.h"
+#include "block_import_pipeline.h"
+
+namespace currency
+{
+  //-----------------------------------------------------------------------------------------------
+  block_import_pipeline::block_import_pipeline(block_download_scheduler& scheduler, size_t max_ready_spans)
+    : m_scheduler(scheduler)
+    , m_max_ready_spans(max_ready_spans)
+    , m_next_span_number(0)
+    , m_next_ready_number(0)
+    , m_stop(false)
+  {}
+  //-----------------------------------------------------------------------------------------------
+  block_import_pipeline::~block_import_pipeline()
+  {
+    deinit();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_import_pipeline::init(size_t threads_count, tx_check_t tx_check)
+  {
+    deinit();
+    m_tx_check = tx_check;
+    m_stop = false;
+    for (size_t i = 0; i < threads_count; i++)
+      m_workers.push_back(boost::thread(boost::bind(&block_import_pipeline::worker_thread, this)));
+    LOG_PRINT_L0("Blocks prevalidation threads: " << threads_count);
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_import_pipeline::deinit()
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      m_stop = true;
+    }
+    m_scheduler.stop();
+    m_span_ready.notify_all();
+    m_span_taken.notify_all();
+    BOOST_FOREACH(boost::thread& th, m_workers)
+      th.join();
+    m_workers.clear();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_import_pipeline::prevalidate_span(block_download_scheduler::span& s, prevalidated_span& ps, const tx_check_t& tx_check)
+  {
+    ps.blocks.clear();
+    ps.valid = false;
+    std::list<block_complete_entry> blocks;
+    blocks.swap(s.blocks);
+    ps.source = s;
+
+    CHECK_AND_ASSERT_MES(blocks.size() == s.ids.size(), false, "blocks count " << blocks.size() << " mismatch with requested ids count " << s.ids.size());
+    ps.blocks.resize(blocks.size());
+    auto id_it = s.ids.begin();
+    auto pb_it = ps.blocks.begin();
+    for (const block_complete_entry& block_entry : blocks)
+    {
+      prevalidated_block& pb = *pb_it++;
+      CHECK_AND_ASSERT_MES(block_entry.block.size() <= get_max_block_size(), false, "too big block blob: " << block_entry.block.size());
+      CHECK_AND_ASSERT_MES(parse_and_validate_block_from_blob(block_entry.block, pb.bl), false, "failed to parse and validate block: \r\n"
+        << epee::string_tools::buff_to_hex_nodelimer(block_entry.block));
+      pb.id = get_block_hash(pb.bl);
+      CHECK_AND_ASSERT_MES(pb.id == *id_it, false, "block " << pb.id << " received instead of requested " << *id_it);
+      ++id_it;
+      CHECK_AND_ASSERT_MES(pb.bl.tx_hashes.size() == block_entry.txs.size(), false, "block " << pb.id << " tx_hashes.size()=" << pb.bl.tx_hashes.size()
+        << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size());
+
+      pb.txs.resize(block_entry.txs.size());
+      pb.tx_hashes.resize(block_entry.txs.size());
+      size_t i = 0;
+      for (const blobdata& tx_blob : block_entry.txs)
+      {
+        CHECK_AND_ASSERT_MES(tx_blob.size() <= get_max_tx_size(), false, "too big transaction blob " << tx_blob.size() << " in block " << pb.id);
+        crypto::hash tx_prefix_hash = null_hash;
+        CHECK_AND_ASSERT_MES(parse_and_validate_tx_from_blob(tx_blob, pb.txs[i], pb.tx_hashes[i], tx_prefix_hash), false, "failed to parse transaction "
+          << i << " of block " << pb.id);
+        CHECK_AND_ASSERT_MES(pb.tx_hashes[i] == pb.bl.tx_hashes[i], false, "transaction " << pb.tx_hashes[i] << " doesn't match block's " << pb.bl.tx_hashes[i]);
+        CHECK_AND_ASSERT_MES(!tx_check || tx_check(pb.txs[i], pb.tx_hashes[i]), false, "transaction " << pb.tx_hashes[i] << " of block " << pb.id << " failed checks");
+        ++i;
+      }
+    }
+    ps.valid = true;
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_import_pipeline::worker_thread()
+  {
+    while (true)
+    {
+      block_download_scheduler::span s = AUTO_VAL_INIT(s);
+      uint64_t number = 0;
+      {
+        boost::unique_lock<boost::mutex> take_lock(m_take_lock);
+        TIME_MEASURE_START(wait_time);
+        {
+          // no more spans are taken than may be buffered
+          boost::unique_lock<boost::mutex> lock(m_lock);
+          while (!m_stop && m_next_span_number - m_next_ready_number >= m_max_ready_spans)
+            m_span_taken.wait(lock);
+          if (m_stop)
+            return;
+        }
+        if (!m_scheduler.wait_next_span(s))
+          return;
+        TIME_MEASURE_FINISH(wait_time);
+        m_prevalidation_counters.wait_time += wait_time;
+
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        number = m_next_span_number++;
+      }
+
+      TIME_MEASURE_START(busy_time);
+      prevalidated_span ps = AUTO_VAL_INIT(ps);
+      if (!prevalidate_span(s, ps, m_tx_check))
+        LOG_PRINT_L0("Blocks span at " << s.start_height << " from " << epee::string_tools::get_ip_string_from_int32(s.remote_ip) << " failed prevalidation");
+      TIME_MEASURE_FINISH(busy_time);
+      m_prevalidation_counters.busy_time += busy_time;
+      m_prevalidation_counters.blocks += ps.blocks.size();
+      ++m_prevalidation_counters.spans;
+
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        m_ready_spans[number] = std::move(ps);
+      }
+      m_span_ready.notify_all();
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool block_import_pipeline::get_next_span(prevalidated_span& ps)
+  {
+    TIME_MEASURE_START(wait_time);
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      while (!m_stop && (m_ready_spans.empty() || m_ready_spans.begin()->first != m_next_ready_number))
+        m_span_ready.wait(lock);
+      if (m_stop)
+        return false;
+
+      ps = std::move(m_ready_spans.begin()->second);
+      m_ready_spans.erase(m_ready_spans.begin());
+      ++m_next_ready_number;
+    }
+    m_span_taken.notify_all();
+    TIME_MEASURE_FINISH(wait_time);
+    m_apply_counters.wait_time += wait_time;
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_import_pipeline::on_span_applied(const prevalidated_span& ps, uint64_t apply_time)
+  {
+    m_apply_counters.busy_time += apply_time;
+    m_apply_counters.blocks += ps.blocks.size();
+    ++m_apply_counters.spans;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void block_import_pipeline::get_stats(stats& st)
+  {
+    m_prevalidation_counters.get(st.prevalidation);
+    m_apply_counters.get(st.apply);
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    st.spans_ready = m_ready_spans.size();
+    st.spans_in_progress = m_next_span_number - m_next_ready_number - st.spans_ready;
+  }
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <vector>
+#include <boost/thread.hpp>
+#include "currency_basic.h"
+#include "block_download_scheduler.h"
+
+namespace currency
+{
+  struct prevalidated_block
+  {
+    block bl;
+    crypto::hash id;
+    std::vector<transaction> txs;
+    std::vector<crypto::hash> tx_hashes;
+  };
+
+  struct prevalidated_span
+  {
+    block_download_scheduler::span source;        // blobs are released once parsed
+    std::vector<prevalidated_block> blocks;
+    bool valid;
+  };
+
+  /************************************************************************/
+  /* Staged import of downloaded blocks. Spans are taken from the         */
+  /* download scheduler in height order; parsing, hashing and context     */
+  /* free checks run for several spans at once on a pool of workers; the  */
+  /* results go to the single applying thread in the same order through a */
+  /* bounded buffer. Every stage counts its busy and waiting time.        */
+  /************************************************************************/
+  class block_import_pipeline
+  {
+  public:
+    // context free transaction checks, called from the worker threads
+    typedef std::function<bool(const transaction& tx, const crypto::hash& tx_hash)> tx_check_t;
+
+    struct stage_stats
+    {
+      uint64_t spans;
+      uint64_t blocks;
+      uint64_t busy_time;                         // microseconds
+      uint64_t wait_time;                         // microseconds, input is empty (or output is full for prevalidation)
+    };
+
+    struct stats
+    {
+      stage_stats prevalidation;
+      stage_stats apply;
+      size_t spans_in_progress;
+      size_t spans_ready;
+    };
+
+    block_import_pipeline(block_download_scheduler& scheduler, size_t max_ready_spans);
+    ~block_import_pipeline();
+
+    bool init(size_t threads_count, tx_check_t tx_check);
+    // stops the scheduler too, so the workers waiting for spans return
+    void deinit();
+
+    // waits for the lowest prevalidated span, false on stop
+    bool get_next_span(prevalidated_span& ps);
+    void on_span_applied(const prevalidated_span& ps, uint64_t apply_time);
+    void get_stats(stats& st);
+
+    static bool prevalidate_span(block_download_scheduler::span& s, prevalidated_span& ps, const tx_check_t& tx_check);
+
+  private:
+    struct stage_counters
+    {
+      stage_counters() : spans(0), blocks(0), busy_time(0), wait_time(0) {}
+      std::atomic<uint64_t> spans;
+      std::atomic<uint64_t> blocks;
+      std::atomic<uint64_t> busy_time;
+      std::atomic<uint64_t> wait_time;
+      void get(stage_stats& st) const { st.spans = spans; st.blocks = blocks; st.busy_time = busy_time; st.wait_time = wait_time; }
+    };
+
+    void worker_thread();
+
+    block_download_scheduler& m_scheduler;
+    const size_t m_max_ready_spans;
+    tx_check_t m_tx_check;
+    std::vector<boost::thread> m_workers;
+
+    boost::mutex m_take_lock;                     // spans are taken from the scheduler and numbered under it, so numbers follow heights
+    boost::mutex m_lock;
+    boost::condition_variable m_span_ready;
+    boost::condition_variable m_span_taken;
+    std::map<uint64_t, prevalidated_span> m_ready_spans; // number -> span
+    uint64_t m_next_span_number;
+    uint64_t m_next_ready_number;
+    bool m_stop;
+
+    stage_counters m_prevalidation_counters;
+    stage_counters m_apply_counters;
+  };
+}
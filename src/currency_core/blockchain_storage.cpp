@@ -34,6 +34,7 @@ using namespace currency;
 #define BLOCKCHAIN_CONTAINER_SPENT_KEYS       "spent_keys"
 #define BLOCKCHAIN_CONTAINER_BLOCKS           "blocks"
 #define BLOCKCHAIN_CONTAINER_OUTPUTS          "outputs"
+#define BLOCKCHAIN_CONTAINER_OUTPUT_ENTRIES    "output_entries"
 #define BLOCKCHAIN_CONTAINER_MULTISIG_OUTS    "multisig_outs"
 #define BLOCKCHAIN_CONTAINER_INVALID_BLOCKS   "invalid_blocks"
 #define BLOCKCHAIN_CONTAINER_TRANSACTIONS     "transactions"
@@ -47,8 +48,15 @@ using namespace currency;
 #define BLOCKCHAIN_OPTIONS_ID_CURRENT_PRUNED_RS_HEIGHT              1
 #define BLOCKCHAIN_OPTIONS_ID_LAST_WORKED_VERSION                   2
 #define BLOCKCHAIN_OPTIONS_ID_STORAGE_MAJOR_COMPABILITY_VERSION     3 //mismatch here means full resync
+#define BLOCKCHAIN_OPTIONS_ID_OUTPUTS_FORMAT_VERSION                4 //mismatch here means outputs index migration
+#define BLOCKCHAIN_OPTIONS_ID_TRANSACTIONS_FORMAT_VERSION           5 //mismatch here means transactions entries migration
 
 #define BLOCKCHAIN_STORAGE_MAJOR_COMPABILITY_VERSION                1
+#define BLOCKCHAIN_OUTPUTS_FORMAT_VERSION                           1
+#define BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION                      2 //transaction_chain_entry serialization version
+
+#define BLOCKCHAIN_OUTPUTS_MIGRATION_BLOCKS_PER_TRANSACTION         1000
+#define BLOCKCHAIN_TRANSACTIONS_MIGRATION_BLOCKS_PER_TRANSACTION    1000
 
 
 DISABLE_VS_WARNINGS(4267)
@@ -56,6 +64,7 @@ DISABLE_VS_WARNINGS(4267)
   namespace
   {
     const command_line::arg_descriptor<std::string>   arg_macos_debuger_dummy_option =     {"-NSDocumentRevisionsDebugMode", "XCode weird paramter", "", true};
+    const command_line::arg_descriptor<uint32_t>      arg_verification_threads =           {"verification-threads", "Specify ring signature verification threads count (0 - hardware concurrency)", 0, true};
   }
   
 
@@ -77,6 +86,8 @@ blockchain_storage::blockchain_storage(tx_memory_pool& tx_pool) : m_lmdb_adapter
                                                                  m_db_current_pruned_rs_height(BLOCKCHAIN_OPTIONS_ID_CURRENT_PRUNED_RS_HEIGHT, m_db_solo_options),
                                                                  m_db_last_worked_version(BLOCKCHAIN_OPTIONS_ID_LAST_WORKED_VERSION, m_db_solo_options),
                                                                  m_db_storage_major_compability_version(BLOCKCHAIN_OPTIONS_ID_STORAGE_MAJOR_COMPABILITY_VERSION, m_db_solo_options),                                                               
+                                                                 m_db_outputs_format_version(BLOCKCHAIN_OPTIONS_ID_OUTPUTS_FORMAT_VERSION, m_db_solo_options),
+                                                                 m_db_transactions_format_version(BLOCKCHAIN_OPTIONS_ID_TRANSACTIONS_FORMAT_VERSION, m_db_solo_options),
                                                                  m_tx_pool(tx_pool),
                                                                  m_is_in_checkpoint_zone(false), 
                                                                  m_donations_account(AUTO_VAL_INIT(m_donations_account)), 
@@ -87,24 +98,28 @@ blockchain_storage::blockchain_storage(tx_memory_pool& tx_pool) : m_lmdb_adapter
 {
   bool r = get_donation_accounts(m_donations_account, m_royalty_account);
   CHECK_AND_ASSERT_THROW_MES(r, "failed to load donation accounts");
+
+  m_db_transactions.enable_cache(CURRENCY_DB_TRANSACTIONS_CACHE_SIZE);
+  m_db_blocks_index.enable_cache(CURRENCY_DB_BLOCKS_INDEX_CACHE_SIZE);
+  m_db_spent_keys.enable_cache(CURRENCY_DB_SPENT_KEYS_CACHE_SIZE);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::have_tx(const crypto::hash &id)
 {
   PROFILE_FUNC("blockchain_storage::have_tx");
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_db_transactions.find(id) != m_db_transactions.end();
 }
 //------------------------------------------------------------------
 bool blockchain_storage::have_tx_keyimg_as_spent(const crypto::key_image &key_im)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return  m_db_spent_keys.find(key_im) != m_db_spent_keys.end();
 }
 //------------------------------------------------------------------
 std::shared_ptr<transaction> blockchain_storage::get_tx(const crypto::hash &id)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto it = m_db_transactions.find(id);
   if (it == m_db_transactions.end())
     return std::shared_ptr<transaction>(nullptr);
@@ -114,7 +129,7 @@ std::shared_ptr<transaction> blockchain_storage::get_tx(const crypto::hash &id)
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_current_blockchain_height()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_db_blocks.size();
 }
 // ------------------------------------------------------------------
@@ -134,6 +149,7 @@ uint64_t blockchain_storage::get_current_blockchain_height()
 void blockchain_storage::init_options(boost::program_options::options_description& desc)
 {
   command_line::add_arg(desc, arg_macos_debuger_dummy_option); 
+  command_line::add_arg(desc, arg_verification_threads);
   db::lmdb_adapter::init_options(desc);
 
 }
@@ -146,6 +162,14 @@ bool blockchain_storage::init(const boost::program_options::variables_map& vm, c
   bool res = m_lmdb_adapter->init(vm);
   CHECK_AND_ASSERT_MES(res, false, "Unable to init lmdb adapter");
 
+  size_t verification_threads = 0;
+  if (command_line::has_arg(vm, arg_verification_threads))
+    verification_threads = command_line::get_arg(vm, arg_verification_threads);
+  if (!verification_threads)
+    verification_threads = std::max(1u, boost::thread::hardware_concurrency());
+  res = m_ring_signature_verifier.init(verification_threads);
+  CHECK_AND_ASSERT_MES(res, false, "Unable to init ring signature verifier");
+
   m_config_folder = config_folder;
   LOG_PRINT_L0("Loading blockchain...");
   const std::string folder_name = m_config_folder + "/" CURRENCY_BLOCKCHAINDATA_FOLDERNAME;
@@ -165,7 +189,7 @@ bool blockchain_storage::init(const boost::program_options::variables_map& vm, c
   CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
   res = m_db_spent_keys.init(BLOCKCHAIN_CONTAINER_SPENT_KEYS);
   CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
-  res = m_db_outputs.init(BLOCKCHAIN_CONTAINER_OUTPUTS);
+  res = m_db_outputs.init(BLOCKCHAIN_CONTAINER_OUTPUT_ENTRIES);
   CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
   res = m_db_solo_options.init(BLOCKCHAIN_CONTAINER_SOLO_OPTIONS);
   CHECK_AND_ASSERT_MES(res, false, "Unable to init db container");
@@ -195,6 +219,19 @@ bool blockchain_storage::init(const boost::program_options::variables_map& vm, c
     CHECK_AND_ASSERT_MES(!bvc.m_verifivation_failed, false, "Failed to add genesis block to blockchain");
     LOG_PRINT_MAGENTA("Storage initialized with genesis", LOG_LEVEL_0);
   }
+  else
+  {
+    if (m_db_outputs_format_version != BLOCKCHAIN_OUTPUTS_FORMAT_VERSION)
+    {
+      res = migrate_outputs_to_output_entries();
+      CHECK_AND_ASSERT_MES(res, false, "Failed to migrate outputs index");
+    }
+    if (m_db_transactions_format_version != BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION)
+    {
+      res = migrate_transactions_format();
+      CHECK_AND_ASSERT_MES(res, false, "Failed to migrate transactions");
+    }
+  }
   initialize_db_solo_options_values();
 
   //print information message
@@ -212,13 +249,147 @@ void blockchain_storage::initialize_db_solo_options_values()
 {
   m_db.begin_transaction();
   m_db_storage_major_compability_version = BLOCKCHAIN_STORAGE_MAJOR_COMPABILITY_VERSION;
+  m_db_outputs_format_version = BLOCKCHAIN_OUTPUTS_FORMAT_VERSION;
+  m_db_transactions_format_version = BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION;
   m_db_last_worked_version = std::string(PROJECT_VERSION_LONG);
   m_db.commit_transaction();
 }
 //------------------------------------------------------------------
+bool blockchain_storage::migrate_outputs_to_output_entries()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  LOG_PRINT_L0("Migrating outputs index to output entries...");
+  legacy_outputs_container legacy_outputs(m_db);
+  bool r = legacy_outputs.init(BLOCKCHAIN_CONTAINER_OUTPUTS);
+  CHECK_AND_ASSERT_MES(r, false, "Unable to init db container");
+
+  // rebuild the whole index from transactions, so an interrupted migration simply starts over
+  auto migrate_block = [&](uint64_t h) -> bool
+  {
+    auto bei_ptr = m_db_blocks[h];
+    CHECK_AND_ASSERT_MES(bei_ptr, false, "block " << h << " not found");
+    std::list<crypto::hash> tx_ids(bei_ptr->bl.tx_hashes.begin(), bei_ptr->bl.tx_hashes.end());
+    tx_ids.push_front(get_transaction_hash(bei_ptr->bl.miner_tx));
+    BOOST_FOREACH(const crypto::hash& tx_id, tx_ids)
+    {
+      auto tx_ptr = m_db_transactions.find(tx_id);
+      CHECK_AND_ASSERT_MES(tx_ptr, false, "transaction " << tx_id << " from block " << h << " not found");
+      std::vector<uint64_t> global_indexes;
+      r = push_transaction_to_global_outs_index(tx_ptr->tx, tx_id, tx_ptr->m_keeper_block_height, global_indexes);
+      CHECK_AND_ASSERT_MES(r, false, "failed to push_transaction_to_global_outs_index tx id " << tx_id);
+      CHECK_AND_ASSERT_MES(global_indexes == tx_ptr->m_global_output_indexes, false, "global output indexes mismatch for tx id " << tx_id);
+      for (size_t i = 0, k = 0; i != tx_ptr->tx.vout.size(); i++)
+      {
+        if (tx_ptr->tx.vout[i].target.type() != typeid(txout_to_key))
+          continue;
+        if (tx_ptr->m_spent_flags[i])
+        {
+          auto out_ptr = m_db_outputs.get_subitem(tx_ptr->tx.vout[i].amount, global_indexes[k]);
+          output_entry oe = *out_ptr;
+          oe.spent = 1;
+          m_db_outputs.set_subitem(tx_ptr->tx.vout[i].amount, global_indexes[k], oe);
+        }
+        ++k;
+      }
+    }
+    return true;
+  };
+
+  try
+  {
+    m_db.begin_transaction();
+    m_db_outputs.clear();
+    m_db.commit_transaction();
+
+    uint64_t height = m_db_blocks.size();
+    for (uint64_t h = 0; h < height;)
+    {
+      m_db.begin_transaction();
+      for (uint64_t end = std::min<uint64_t>(h + BLOCKCHAIN_OUTPUTS_MIGRATION_BLOCKS_PER_TRANSACTION, height); h != end; h++)
+      {
+        if (!migrate_block(h))
+        {
+          m_db.abort_transaction();
+          return false;
+        }
+      }
+      m_db.commit_transaction();
+      LOG_PRINT_L0("Outputs index migration: " << h << "/" << height << " blocks");
+    }
+
+    m_db.begin_transaction();
+    legacy_outputs.clear();
+    m_db_outputs_format_version = BLOCKCHAIN_OUTPUTS_FORMAT_VERSION;
+    m_db.commit_transaction();
+  }
+  catch (const std::exception& ex)
+  {
+    m_db.abort_transaction();
+    LOG_ERROR("EXCEPTION WHILE MIGRATING OUTPUTS INDEX: " << ex.what());
+    return false;
+  }
+  LOG_PRINT_L0("Outputs index migration finished");
+  return true;
+}
+//------------------------------------------------------------------
+bool blockchain_storage::migrate_transactions_format()
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  LOG_PRINT_L0("Migrating transactions to format version " << BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION << "...");
+
+  // every entry is simply stored again, so the current layout is written; an interrupted migration just starts over
+  auto migrate_block = [&](uint64_t h) -> bool
+  {
+    auto bei_ptr = m_db_blocks[h];
+    CHECK_AND_ASSERT_MES(bei_ptr, false, "block " << h << " not found");
+    std::list<crypto::hash> tx_ids(bei_ptr->bl.tx_hashes.begin(), bei_ptr->bl.tx_hashes.end());
+    tx_ids.push_front(get_transaction_hash(bei_ptr->bl.miner_tx));
+    BOOST_FOREACH(const crypto::hash& tx_id, tx_ids)
+    {
+      auto tx_ptr = m_db_transactions.find(tx_id);
+      CHECK_AND_ASSERT_MES(tx_ptr, false, "transaction " << tx_id << " from block " << h << " not found");
+      if (tx_ptr->version < BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION)
+        m_db_transactions.set(tx_id, *tx_ptr);
+    }
+    return true;
+  };
+
+  try
+  {
+    uint64_t height = m_db_blocks.size();
+    for (uint64_t h = 0; h < height;)
+    {
+      m_db.begin_transaction();
+      for (uint64_t end = std::min<uint64_t>(h + BLOCKCHAIN_TRANSACTIONS_MIGRATION_BLOCKS_PER_TRANSACTION, height); h != end; h++)
+      {
+        if (!migrate_block(h))
+        {
+          m_db.abort_transaction();
+          return false;
+        }
+      }
+      m_db.commit_transaction();
+      LOG_PRINT_L0("Transactions migration: " << h << "/" << height << " blocks");
+    }
+
+    m_db.begin_transaction();
+    m_db_transactions_format_version = BLOCKCHAIN_TRANSACTIONS_FORMAT_VERSION;
+    m_db.commit_transaction();
+  }
+  catch (const std::exception& ex)
+  {
+    m_db.abort_transaction();
+    LOG_ERROR("EXCEPTION WHILE MIGRATING TRANSACTIONS: " << ex.what());
+    return false;
+  }
+  LOG_PRINT_L0("Transactions migration finished");
+  return true;
+}
+//------------------------------------------------------------------
 bool blockchain_storage::deinit()
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  m_ring_signature_verifier.deinit();
   m_scratchpad_wr.deinit();
   m_db.close();
   tools::unlock_and_close_file(m_locker_file);
@@ -382,7 +553,7 @@ bool blockchain_storage::reset_and_set_genesis_block(const block& b)
 //------------------------------------------------------------------
 bool blockchain_storage::copy_scratchpad(std::vector<crypto::hash>& scr)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   scr = m_scratchpad_wr.get_scratchpad();
   return true;
 }
@@ -400,17 +571,39 @@ bool blockchain_storage::copy_scratchpad(std::vector<crypto::hash>& scr)
 // }
 bool blockchain_storage::copy_scratchpad_as_blob(std::string& dst)
 {
+  scratchpad_snapshot_ptr snapshot = get_scratchpad_snapshot();
+  for (const auto& page : snapshot->pages)
+    dst.append(*page);
+  return true;
+}
+//------------------------------------------------------------------
+blockchain_storage::scratchpad_snapshot_ptr blockchain_storage::get_scratchpad_snapshot()
+{
+  {
+    CRITICAL_REGION_LOCAL(m_scratchpad_snapshot_lock);
+    if (m_scratchpad_snapshot && m_scratchpad_snapshot->version == m_scratchpad_wr.get_version())
+      return m_scratchpad_snapshot;
+  }
 
-  //TODO here:
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
-  std::vector<crypto::hash> scr;
-  copy_scratchpad(scr);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
+  CRITICAL_REGION_LOCAL(m_scratchpad_snapshot_lock);
+  //could have been taken by another caller meanwhile
+  if (m_scratchpad_snapshot && m_scratchpad_snapshot->version == m_scratchpad_wr.get_version())
+    return m_scratchpad_snapshot;
 
-  if (scr.size())
+  PROFILE_FUNC("blockchain_storage::get_scratchpad_snapshot");
+  boost::shared_ptr<scratchpad_snapshot> snapshot(new scratchpad_snapshot());
+  snapshot->version = m_scratchpad_wr.get_version();
+  snapshot->top_id = get_top_block_id(snapshot->height);
+  const std::vector<crypto::hash>& scr = m_scratchpad_wr.get_scratchpad();
+  const size_t page_hashes = CURRENCY_SCRATCHPAD_SNAPSHOT_PAGE_SIZE / sizeof(crypto::hash);
+  for (size_t i = 0; i < scr.size(); i += page_hashes)
   {
-    dst.append(reinterpret_cast<const char*>(&scr[0]), scr.size() * 32);
+    size_t count = std::min(page_hashes, scr.size() - i);
+    snapshot->pages.push_back(boost::shared_ptr<const std::string>(new std::string(reinterpret_cast<const char*>(&scr[i]), count * sizeof(crypto::hash))));
   }
-  return true;
+  m_scratchpad_snapshot = snapshot;
+  return m_scratchpad_snapshot;
 }
 //------------------------------------------------------------------
 bool blockchain_storage::purge_transaction_keyimages_from_blockchain(const transaction& tx, bool strict_check)
@@ -504,14 +697,14 @@ bool blockchain_storage::purge_block_data_from_blockchain(const block& bl, size_
 //------------------------------------------------------------------
 crypto::hash blockchain_storage::get_top_block_id(uint64_t& height)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   height = get_current_blockchain_height()-1;
   return get_top_block_id();
 }
 //------------------------------------------------------------------
 crypto::hash blockchain_storage::get_top_block_id()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   crypto::hash id = null_hash;
   if(m_db_blocks.size())
   {
@@ -522,7 +715,7 @@ crypto::hash blockchain_storage::get_top_block_id()
 //------------------------------------------------------------------
 bool blockchain_storage::get_top_block(block& b)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   CHECK_AND_ASSERT_MES(m_db_blocks.size(), false, "Wrong blockchain state, m_blocks.size()=0!");
   auto val_ptr = m_db_blocks.back();
   CHECK_AND_ASSERT_MES(val_ptr.get(), false, "m_blocks.back() returned null");
@@ -532,7 +725,7 @@ bool blockchain_storage::get_top_block(block& b)
 //------------------------------------------------------------------
 bool blockchain_storage::get_short_chain_history(std::list<crypto::hash>& ids)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   size_t i = 0;
   size_t current_multiplier = 1;
   size_t sz = m_db_blocks.size();
@@ -563,7 +756,7 @@ bool blockchain_storage::get_short_chain_history(std::list<crypto::hash>& ids)
 //------------------------------------------------------------------
 crypto::hash blockchain_storage::get_block_id_by_height(uint64_t height)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (height >= m_db_blocks.size())
     return null_hash;
 
@@ -571,7 +764,7 @@ crypto::hash blockchain_storage::get_block_id_by_height(uint64_t height)
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_by_hash(const crypto::hash &h, block &blk) {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   // try to find block in main chain
   auto it = m_db_blocks_index.find(h);
@@ -594,7 +787,7 @@ bool blockchain_storage::get_block_by_hash(const crypto::hash &h, block &blk) {
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_extended_info_by_hash(const crypto::hash &h, block_extended_info &blk) const
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   // try to find block in main chain
   auto vptr = m_db_blocks_index.find(h);
@@ -616,7 +809,7 @@ bool blockchain_storage::get_block_extended_info_by_hash(const crypto::hash &h,
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_extended_info_by_height(uint64_t h, block_extended_info &blk) const
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   if (h >= m_db_blocks.size())
     return false;
@@ -625,9 +818,99 @@ bool blockchain_storage::get_block_extended_info_by_height(uint64_t h, block_ext
   return true;
 }
 //------------------------------------------------------------------
+bool blockchain_storage::get_block_blob_by_height(uint64_t h, blobdata& blob) const
+{
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
+
+  if (h >= m_db_blocks.size())
+    return false;
+
+  return m_db_blocks.get_stored_and_visit(h, [&blob](const void* data, size_t size) -> bool
+  {
+    return get_block_blob_from_stored_entry(data, size, blob);
+  });
+}
+//------------------------------------------------------------------
+bool blockchain_storage::get_transaction_blob(const crypto::hash& tx_id, blobdata& blob) const
+{
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
+
+  return m_db_transactions.get_stored_and_visit(tx_id, [&blob](const void* data, size_t size) -> bool
+  {
+    return get_transaction_blob_from_stored_entry(data, size, blob);
+  });
+}
+//------------------------------------------------------------------
+bool blockchain_storage::get_block_blob_from_stored_entry(const void* data, size_t size, blobdata& blob)
+{
+  // stored block_extended_info is [uint32 version][block][fixed size fields], measure the latter once
+  static const size_t trailer_size = []() -> size_t
+  {
+    block_extended_info bei = AUTO_VAL_INIT(bei);
+    return t_serializable_object_to_blob(bei).size() - sizeof(uint32_t) - t_serializable_object_to_blob(bei.bl).size();
+  }();
+
+  uint32_t version = 0;
+  CHECK_AND_ASSERT_MES(size > sizeof(version) + trailer_size, false, "stored block entry is too small: " << size << " bytes");
+  memcpy(&version, data, sizeof(version));
+  CHECK_AND_ASSERT_MES(version == block_extended_info::get_serialization_veraion(), false, "unexpected stored block entry version: " << version);
+
+  blob.assign(static_cast<const char*>(data) + sizeof(version), size - sizeof(version) - trailer_size);
+  return true;
+}
+//------------------------------------------------------------------
+bool blockchain_storage::get_transaction_blob_from_stored_entry(const void* data, size_t size, blobdata& blob)
+{
+  blob_view_streambuf buf(data, size);
+  std::istream is(&buf);
+  binary_archive<false> ba(is);
+
+  uint32_t version = 0;
+  bool r = ::do_serialize(ba, version);
+  CHECK_AND_ASSERT_MES(r, false, "failed to read stored transaction entry version");
+  if (version < 2)
+  {
+    // tx is in the middle of old entries, so they have to be parsed
+    transaction_chain_entry tce = AUTO_VAL_INIT(tce);
+    r = t_unserializable_object_from_blob(tce, data, size);
+    CHECK_AND_ASSERT_MES(r, false, "failed to parse stored transaction entry");
+    blob = t_serializable_object_to_blob(tce.tx);
+    return true;
+  }
+
+  // skip everything transaction_chain_entry stores before tx
+  uint64_t keeper_block_height = 0;
+  std::vector<uint64_t> global_output_indexes;
+  std::vector<bool> spent_flags;
+  r = ::do_serialize(ba, version) && ::do_serialize(ba, keeper_block_height) && ::do_serialize(ba, global_output_indexes) && ::do_serialize(ba, spent_flags);
+  CHECK_AND_ASSERT_MES(r && is.good(), false, "failed to read stored transaction entry fields");
+
+  std::streamoff tx_offset = is.tellg();
+  CHECK_AND_ASSERT_MES(tx_offset > 0 && static_cast<size_t>(tx_offset) < size, false, "wrong stored transaction entry: tx offset " << tx_offset << ", size " << size);
+  blob.assign(static_cast<const char*>(data) + tx_offset, size - static_cast<size_t>(tx_offset));
+  return true;
+}
+//------------------------------------------------------------------
+bool blockchain_storage::get_block_complete_entry(uint64_t h, block_complete_entry& e) const
+{
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
+
+  bool r = get_block_blob_by_height(h, e.block);
+  CHECK_AND_ASSERT_MES(r, false, "internal error: failed to get blob of block at height " << h);
+
+  auto bei_ptr = m_db_blocks[h];
+  BOOST_FOREACH(const crypto::hash& tx_id, bei_ptr->bl.tx_hashes)
+  {
+    e.txs.push_back(blobdata());
+    r = get_transaction_blob(tx_id, e.txs.back());
+    CHECK_AND_ASSERT_MES(r, false, "internal error: failed to get blob of transaction " << tx_id << " from block at height " << h);
+  }
+  return true;
+}
+//------------------------------------------------------------------
 bool blockchain_storage::get_block_by_height(uint64_t h, block &blk)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (h >= m_db_blocks.size())
     return false;
   blk = m_db_blocks[h]->bl;
@@ -738,7 +1021,7 @@ bool blockchain_storage::switch_to_alternative_blockchain(std::list<blocks_ext_b
 //------------------------------------------------------------------
 wide_difficulty_type blockchain_storage::get_difficulty_for_next_block()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   std::vector<uint64_t> timestamps;
   std::vector<wide_difficulty_type> commulative_difficulties;
   size_t offset = m_db_blocks.size() - std::min(m_db_blocks.size(), static_cast<size_t>(DIFFICULTY_BLOCKS_COUNT));
@@ -760,7 +1043,7 @@ wide_difficulty_type blockchain_storage::get_next_difficulty_for_alternative_cha
   std::vector<wide_difficulty_type> commulative_difficulties;
   if (alt_chain.size()< DIFFICULTY_BLOCKS_COUNT)
   {
-    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    BLOCKCHAIN_SHARED_REGION_LOCAL();
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = DIFFICULTY_BLOCKS_COUNT - std::min(static_cast<size_t>(DIFFICULTY_BLOCKS_COUNT), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -867,7 +1150,7 @@ bool blockchain_storage::lookfor_donation(const transaction& tx, uint64_t& donat
 bool blockchain_storage::get_required_donations_value_for_next_block(uint64_t& don_am)
 {
   TRY_ENTRY();
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   uint64_t sz = get_current_blockchain_height();
   if (sz < CURRENCY_DONATIONS_INTERVAL || sz%CURRENCY_DONATIONS_INTERVAL)
   {
@@ -886,7 +1169,7 @@ bool blockchain_storage::get_required_donations_value_for_next_block(uint64_t& d
 //------------------------------------------------------------------
 bool blockchain_storage::validate_donations_value(uint64_t donation, uint64_t royalty)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   uint64_t expected_don_total = 0;
   if (!get_required_donations_value_for_next_block(expected_don_total))
     return false;
@@ -903,7 +1186,7 @@ bool blockchain_storage::validate_donations_value(uint64_t donation, uint64_t ro
 //------------------------------------------------------------------
 bool blockchain_storage::validate_miner_transaction(const block& b, size_t cumulative_block_size, uint64_t fee, uint64_t& base_reward, uint64_t already_generated_coins, uint64_t already_donated_coins, uint64_t& donation_total)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   //validate reward
   uint64_t money_in_use = 0;
   uint64_t royalty = 0;
@@ -956,7 +1239,7 @@ bool blockchain_storage::validate_miner_transaction(const block& b, size_t cumul
 //------------------------------------------------------------------
 bool blockchain_storage::get_backward_blocks_sizes(size_t from_height, std::vector<size_t>& sz, size_t count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   CHECK_AND_ASSERT_MES(from_height < m_db_blocks.size(), false, "Internal error: get_backward_blocks_sizes called with from_height=" << from_height << ", blockchain height = " << m_db_blocks.size());
 
   size_t start_offset = (from_height + 1) - std::min((from_height + 1), count);
@@ -968,7 +1251,7 @@ bool blockchain_storage::get_backward_blocks_sizes(size_t from_height, std::vect
 //------------------------------------------------------------------
 bool blockchain_storage::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (!m_db_blocks.size())
     return true;
   return get_backward_blocks_sizes(m_db_blocks.size() - 1, sz, count);
@@ -981,7 +1264,7 @@ uint64_t blockchain_storage::get_current_comulative_blocksize_limit()
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_already_generated_coins(crypto::hash &hash, uint64_t &count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto it = m_db_blocks_index.find(hash);
   if (m_db_blocks_index.end() != it) {
     count = m_db_blocks[*it]->already_generated_coins;
@@ -992,7 +1275,7 @@ uint64_t blockchain_storage::get_already_generated_coins(crypto::hash &hash, uin
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_already_donated_coins(crypto::hash &hash, uint64_t &count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto it = m_db_blocks_index.find(hash);
   if (m_db_blocks_index.end() != it) {
     count = m_db_blocks[*it]->already_donated_coins;
@@ -1003,7 +1286,7 @@ uint64_t blockchain_storage::get_already_donated_coins(crypto::hash &hash, uint6
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_containing_tx(const crypto::hash &txId, crypto::hash &blockId, uint64_t &blockHeight)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto it = m_db_transactions.find(txId);
   if (!it) {
     return false;
@@ -1022,7 +1305,7 @@ bool blockchain_storage::create_block_template(block& b, const account_public_ad
   uint64_t already_donated_coins;
   uint64_t donation_amount_for_this_block = 0;
 
-  CRITICAL_REGION_BEGIN(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_BEGIN();
   b.major_version = CURRENT_BLOCK_MAJOR_VERSION;
   b.minor_version = CURRENT_BLOCK_MINOR_VERSION;
   b.prev_id = get_top_block_id();
@@ -1040,7 +1323,7 @@ bool blockchain_storage::create_block_template(block& b, const account_public_ad
   already_generated_coins = m_db_blocks.back()->already_generated_coins;
   already_donated_coins = m_db_blocks.back()->already_donated_coins;
 
-  CRITICAL_REGION_END();
+  BLOCKCHAIN_SHARED_REGION_END();
 
   size_t txs_size;
   uint64_t fee;
@@ -1147,7 +1430,7 @@ bool blockchain_storage::complete_timestamps_vector(uint64_t start_top_height, s
   if (timestamps.size() >= BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW)
     return true;
 
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   size_t need_elements = BLOCKCHAIN_TIMESTAMP_CHECK_WINDOW - timestamps.size();
   CHECK_AND_ASSERT_MES(start_top_height < m_db_blocks.size(), false, "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_db_blocks.size());
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
@@ -1364,7 +1647,7 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
 //------------------------------------------------------------------
 bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks, std::list<transaction>& txs)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (start_offset >= m_db_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_db_blocks.size(); i++)
@@ -1410,7 +1693,7 @@ bool blockchain_storage::finish_batch_exclusive_operation(bool success)
 //------------------------------------------------------------------
 bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::list<block>& blocks)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (start_offset >= m_db_blocks.size())
     return false;
 
@@ -1421,40 +1704,56 @@ bool blockchain_storage::get_blocks(uint64_t start_offset, size_t count, std::li
 //------------------------------------------------------------------
 bool blockchain_storage::handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   rsp.current_blockchain_height = get_current_blockchain_height();
-  std::list<block> blocks;
-  get_blocks(arg.blocks, blocks, rsp.missed_ids);
 
-  BOOST_FOREACH(const auto& bl, blocks)
+  //blocks and their transactions are sent as they are stored
+  BOOST_FOREACH(const auto& bl_id, arg.blocks)
   {
-    std::list<crypto::hash> missed_tx_id;
-    std::list<transaction> txs;
-    get_transactions(bl.tx_hashes, txs, rsp.missed_ids);
-    CHECK_AND_ASSERT_MES(!missed_tx_id.size(), false, "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size()
-      << ENDL << "for block id = " << get_block_hash(bl));
+    auto block_ind_ptr = m_db_blocks_index.find(bl_id);
+    if (!block_ind_ptr)
+    {
+      rsp.missed_ids.push_back(bl_id);
+      continue;
+    }
     rsp.blocks.push_back(block_complete_entry());
-    block_complete_entry& e = rsp.blocks.back();
-    //pack block
-    e.block = t_serializable_object_to_blob(bl);
-    //pack transactions
-    BOOST_FOREACH(transaction& tx, txs)
-      e.txs.push_back(t_serializable_object_to_blob(tx));
-
+    bool r = get_block_complete_entry(*block_ind_ptr, rsp.blocks.back());
+    CHECK_AND_ASSERT_MES(r, false, "Internal error: failed to get complete entry for block id = " << bl_id);
   }
+
   //get another transactions, if need
-  std::list<transaction> txs;
-  get_transactions(arg.txs, txs, rsp.missed_ids);
-  //pack aside transactions
-  BOOST_FOREACH(const auto& tx, txs)
-    rsp.txs.push_back(t_serializable_object_to_blob(tx));
+  BOOST_FOREACH(const auto& tx_id, arg.txs)
+  {
+    blobdata tx_blob;
+    if (get_transaction_blob(tx_id, tx_blob))
+    {
+      rsp.txs.push_back(std::move(tx_blob));
+      continue;
+    }
+    transaction tx;
+    if (m_tx_pool.get_transaction(tx_id, tx))
+      rsp.txs.push_back(t_serializable_object_to_blob(tx));
+    else
+      rsp.missed_ids.push_back(tx_id);
+  }
 
   return true;
 }
 //------------------------------------------------------------------
+void blockchain_storage::get_db_cache_stats(std::map<std::string, db::cache_stats>& stats)
+{
+  db::cache_stats cs = AUTO_VAL_INIT(cs);
+  if (m_db_transactions.get_cache_stats(cs))
+    stats[BLOCKCHAIN_CONTAINER_TRANSACTIONS] = cs;
+  if (m_db_blocks_index.get_cache_stats(cs))
+    stats[BLOCKCHAIN_CONTAINER_BLOCKS_INDEX] = cs;
+  if (m_db_spent_keys.get_cache_stats(cs))
+    stats[BLOCKCHAIN_CONTAINER_SPENT_KEYS] = cs;
+}
+//------------------------------------------------------------------
 bool blockchain_storage::get_transactions_daily_stat(uint64_t& daily_cnt, uint64_t& daily_volume)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   daily_cnt = daily_volume = 0;
   for (size_t i = (m_db_blocks.size() > CURRENCY_BLOCK_PER_DAY ? m_db_blocks.size() - CURRENCY_BLOCK_PER_DAY : 0); i != m_db_blocks.size(); i++)
   {
@@ -1476,7 +1775,7 @@ bool blockchain_storage::get_transactions_daily_stat(uint64_t& daily_cnt, uint64
 bool blockchain_storage::check_keyimages(const std::list<crypto::key_image>& images, std::list<bool>& images_stat)
 {
   //true - unspent, false - spent
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   for (auto& ki : images)
   {
     images_stat.push_back(m_db_spent_keys.count(ki) ? false : true);
@@ -1486,7 +1785,7 @@ bool blockchain_storage::check_keyimages(const std::list<crypto::key_image>& ima
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_current_hashrate(size_t aprox_count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (m_db_blocks.size() <= aprox_count)
     return 0;
 
@@ -1497,7 +1796,7 @@ uint64_t blockchain_storage::get_current_hashrate(size_t aprox_count)
 //------------------------------------------------------------------
 bool blockchain_storage::extport_scratchpad_to_file(const std::string& path)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   export_scratchpad_file_header fh;
   memset(&fh, 0, sizeof(fh));
   const std::vector<crypto::hash>& scr_vector = m_scratchpad_wr.get_scratchpad();
@@ -1540,7 +1839,7 @@ bool blockchain_storage::extport_scratchpad_to_file(const std::string& path)
 //------------------------------------------------------------------
 bool blockchain_storage::get_alternative_blocks(std::list<block>& blocks)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   BOOST_FOREACH(const auto& alt_bl, m_alternative_chains)
   {
@@ -1551,35 +1850,30 @@ bool blockchain_storage::get_alternative_blocks(std::list<block>& blocks)
 //------------------------------------------------------------------
 size_t blockchain_storage::get_alternative_blocks_count()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_alternative_chains.size();
 }
 //------------------------------------------------------------------
 bool blockchain_storage::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i, uint64_t mix_count, bool use_only_forced_to_mix)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto out_ptr = m_db_outputs.get_subitem(amount, i);
-  auto tx_ptr = m_db_transactions.find(out_ptr->first);
-  CHECK_AND_ASSERT_MES(tx_ptr, false, "internal error: transaction with id " << out_ptr->first << ENDL <<
-    ", used in mounts global index for amount=" << amount << ": i=" << i << "not found in transactions index");
-  CHECK_AND_ASSERT_MES(tx_ptr->tx.vout.size() > out_ptr->second, false, "internal error: in global outs index, transaction out index="
-    << out_ptr->second << " more than transaction outputs = " << tx_ptr->tx.vout.size() << ", for tx id = " << out_ptr->first);
-
-  const transaction& tx = tx_ptr->tx;
-  CHECK_AND_ASSERT_MES(tx.vout[out_ptr->second].target.type() == typeid(txout_to_key), false, "unknown tx out type");
-
-  CHECK_AND_ASSERT_MES(tx_ptr->m_spent_flags.size() == tx.vout.size(), false, "internal error");
-
+  return add_out_to_get_random_outs(result_outs, amount, i, *out_ptr, mix_count, use_only_forced_to_mix);
+}
+//------------------------------------------------------------------
+bool blockchain_storage::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i, const outputs_container::t_value_type& out_entry, uint64_t mix_count, bool use_only_forced_to_mix)
+{
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   //do not use outputs that obviously spent for mixins
-  if (tx_ptr->m_spent_flags[out_ptr->second])
+  if (out_entry.spent)
     return false;
 
   //check if transaction is unlocked
-  if (!is_tx_spendtime_unlocked(tx.unlock_time))
+  if (!is_tx_spendtime_unlocked(out_entry.unlock_time))
     return false;
 
   //use appropriate mix_attr out 
-  uint8_t mix_attr = boost::get<txout_to_key>(tx.vout[out_ptr->second].target).mix_attr;
+  uint8_t mix_attr = out_entry.mix_attr;
 
   if (mix_attr == CURRENCY_TO_KEY_OUT_FORCED_NO_MIX)
     return false; //COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS call means that ring signature will have more than one entry.
@@ -1591,33 +1885,41 @@ bool blockchain_storage::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPU
 
   COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry& oen = *result_outs.outs.insert(result_outs.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::out_entry());
   oen.global_amount_index = i;
-  oen.out_key = boost::get<txout_to_key>(tx.vout[out_ptr->second].target).key;
+  oen.out_key = out_entry.out_key;
   return true;
 }
 //------------------------------------------------------------------
 size_t blockchain_storage::find_end_of_allowed_index(uint64_t amount)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   uint64_t sz = m_db_outputs.get_item_size(amount);
 
   if (!sz)
     return 0;
-  uint64_t i = sz;
+  uint64_t current_height = get_current_blockchain_height();
+  // read the outputs from the top in chunks rather than one by one
+  const uint64_t chunk_size = 64;
+  std::vector<std::shared_ptr<const outputs_container::t_value_type>> outs;
+  uint64_t chunk_end = sz;
   do
   {
-    --i;
-    auto out_ptr = m_db_outputs.get_subitem(amount, i);
-    auto tx_ptr = m_db_transactions.find(out_ptr->first);
-    CHECK_AND_ASSERT_MES(tx_ptr, 0, "internal error: failed to find transaction from outputs index with tx_id=" << out_ptr->first);
-    if (tx_ptr->m_keeper_block_height + CURRENCY_MINED_MONEY_UNLOCK_WINDOW <= get_current_blockchain_height())
-      return i + 1;
-  } while (i != 0);
+    uint64_t chunk_begin = chunk_end > chunk_size ? chunk_end - chunk_size : 0;
+    m_db_outputs.get_subitems(amount, chunk_begin, chunk_end, outs);
+    uint64_t i = chunk_end;
+    do
+    {
+      --i;
+      if (outs[i - chunk_begin]->keeper_block_height + CURRENCY_MINED_MONEY_UNLOCK_WINDOW <= current_height)
+        return i + 1;
+    } while (i != chunk_begin);
+    chunk_end = chunk_begin;
+  } while (chunk_end != 0);
   return 0;
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   BOOST_FOREACH(uint64_t amount, req.amounts)
   {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1632,20 +1934,29 @@ bool blockchain_storage::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDO
     //lets find upper bound of not fresh outs
     size_t up_index_limit = find_end_of_allowed_index(amount);
     CHECK_AND_ASSERT_MES(up_index_limit <= outs_container_size, false, "internal error: find_end_of_allowed_index returned wrong index=" << up_index_limit << ", with amount_outs.size = " << outs_container_size);
+    std::vector<std::shared_ptr<const outputs_container::t_value_type>> outs;
     if (up_index_limit >= req.outs_count)
     {
       std::set<size_t> used;
       size_t try_count = 0;
       for (uint64_t j = 0; j != req.outs_count && try_count < up_index_limit;)
       {
-        size_t i = crypto::rand<size_t>() % up_index_limit;
-        if (used.count(i))
-          continue;
-        bool added = add_out_to_get_random_outs(result_outs, amount, i, req.outs_count, req.use_forced_mix_outs);
-        used.insert(i);
-        if (added)
-          ++j;
-        ++try_count;
+        // pick as many new random outputs as still needed and read them with one ordered scan
+        std::vector<size_t> indices;
+        size_t batch_size = static_cast<size_t>(std::min<uint64_t>(req.outs_count - j, up_index_limit - try_count));
+        while (indices.size() != batch_size)
+        {
+          size_t i = crypto::rand<size_t>() % up_index_limit;
+          if (used.insert(i).second)
+            indices.push_back(i);
+        }
+        m_db_outputs.get_subitems(amount, indices, outs);
+        for (size_t k = 0; k != indices.size() && j != req.outs_count; ++k)
+        {
+          if (add_out_to_get_random_outs(result_outs, amount, indices[k], *outs[k], req.outs_count, req.use_forced_mix_outs))
+            ++j;
+          ++try_count;
+        }
       }
       if (result_outs.outs.size() < req.outs_count)
       {
@@ -1655,8 +1966,9 @@ bool blockchain_storage::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDO
     else
     {
       size_t added = 0;
+      m_db_outputs.get_subitems(amount, 0, up_index_limit, outs);
       for (size_t i = 0; i != up_index_limit; i++)
-        added += add_out_to_get_random_outs(result_outs, amount, i, req.outs_count, req.use_forced_mix_outs) ? 1 : 0;
+        added += add_out_to_get_random_outs(result_outs, amount, i, *outs[i], req.outs_count, req.use_forced_mix_outs) ? 1 : 0;
       LOG_PRINT_RED_L0("Not enough inputs for amount " << amount << ", needed " << req.outs_count << ", added " << added << " good outs from " << up_index_limit << " unlocked of " << outs_container_size << " total - respond with all good outs");
     }
   }
@@ -1669,8 +1981,10 @@ bool blockchain_storage::update_spent_tx_flags_for_input(uint64_t amount, uint64
   uint64_t outs_count = m_db_outputs.get_item_size(amount);
   CHECK_AND_ASSERT_MES(outs_count, false, "Amount " << amount << " have not found during update_spent_tx_flags_for_input()");
   CHECK_AND_ASSERT_MES(global_index < outs_count, false, "Global index" << global_index << " for amount " << amount << " bigger value than amount's vector size()=" << outs_count);
-  auto out_ptr = m_db_outputs.get_subitem(amount, global_index);
-  return update_spent_tx_flags_for_input(out_ptr->first, out_ptr->second, spent);
+  output_entry out_entry = *m_db_outputs.get_subitem(amount, global_index);
+  out_entry.spent = spent ? 1 : 0;
+  m_db_outputs.set_subitem(amount, global_index, out_entry);
+  return update_spent_tx_flags_for_input(out_entry.tx_id, out_entry.out_no, spent);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::update_spent_tx_flags_for_input(const crypto::hash& tx_id, size_t n, bool spent)
@@ -1715,7 +2029,7 @@ bool blockchain_storage::update_spent_tx_flags_for_input(const crypto::hash& tx_
 //------------------------------------------------------------------
 bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   if (!qblock_ids.size() /*|| !req.m_total_height*/)
   {
@@ -1762,7 +2076,7 @@ bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash
 //------------------------------------------------------------------
 wide_difficulty_type blockchain_storage::block_difficulty(size_t i)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   CHECK_AND_ASSERT_MES(i < m_db_blocks.size(), false, "wrong block index i = " << i << " at blockchain_storage::block_difficulty()");
   if (i == 0)
     return m_db_blocks[i]->cumulative_difficulty;
@@ -1773,7 +2087,7 @@ wide_difficulty_type blockchain_storage::block_difficulty(size_t i)
 void blockchain_storage::print_blockchain(uint64_t start_index, uint64_t end_index)
 {
   std::stringstream ss;
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (start_index >= m_db_blocks.size())
   {
     LOG_PRINT_L0("Wrong starter index set: " << start_index << ", expected max index " << m_db_blocks.size() - 1);
@@ -1827,7 +2141,7 @@ void blockchain_storage::print_blockchain_outs(const std::string& file)
 //------------------------------------------------------------------
 bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (!find_blockchain_supplement(qblock_ids, resp.start_height))
     return false;
 
@@ -1838,29 +2152,27 @@ bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash
   return true;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
+bool blockchain_storage::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   PROF_L2_START(find_blockchain_supplement_time);
   if (!find_blockchain_supplement(qblock_ids, start_height))
     return false;
   PROF_L2_FINISH(find_blockchain_supplement_time);
 
-  PROF_L2_START(get_transactions_time);
+  PROF_L2_START(get_blobs_time);
   total_height = get_current_blockchain_height();
   size_t count = 0;
   size_t txs_count = 0;
   for (size_t i = start_height; i != m_db_blocks.size() && count < max_count; i++, count++)
   {
-    blocks.resize(blocks.size() + 1);
-    blocks.back().first = m_db_blocks[i]->bl;
-    std::list<crypto::hash> mis;
-    get_transactions(m_db_blocks[i]->bl.tx_hashes, blocks.back().second, mis);
-    CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, transaction from block not found");
-    txs_count += blocks.back().second.size();
+    blocks.push_back(block_complete_entry());
+    bool r = get_block_complete_entry(i, blocks.back());
+    CHECK_AND_ASSERT_MES(r, false, "internal error, failed to get complete entry for block at height " << i);
+    txs_count += blocks.back().txs.size();
   }
-  PROF_L2_FINISH(get_transactions_time);
-  PROF_L2_LOG_PRINT("find_blockchain_supplement(5): " << blocks.size() << " blocks, " << txs_count << " txs, timings: " << print_mcsec_as_ms(find_blockchain_supplement_time) << " / " << print_mcsec_as_ms(get_transactions_time), LOG_LEVEL_1);
+  PROF_L2_FINISH(get_blobs_time);
+  PROF_L2_LOG_PRINT("find_blockchain_supplement(5): " << blocks.size() << " blocks, " << txs_count << " txs, timings: " << print_mcsec_as_ms(find_blockchain_supplement_time) << " / " << print_mcsec_as_ms(get_blobs_time), LOG_LEVEL_1);
   return true;
 }
 //------------------------------------------------------------------
@@ -1882,7 +2194,7 @@ bool blockchain_storage::add_block_as_invalid(const block_extended_info& bei, co
 //------------------------------------------------------------------
 bool blockchain_storage::have_block(const crypto::hash& id)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (m_db_blocks_index.find(id))
     return true;
   if (m_alternative_chains.count(id))
@@ -1904,7 +2216,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, block_verif
   return handle_block_to_main_chain(bl, id, bvc);
 }
 //------------------------------------------------------------------
-bool blockchain_storage::push_transaction_to_global_outs_index(const transaction& tx, const crypto::hash& tx_id, std::vector<uint64_t>& global_indexes)
+bool blockchain_storage::push_transaction_to_global_outs_index(const transaction& tx, const crypto::hash& tx_id, uint64_t keeper_block_height, std::vector<uint64_t>& global_indexes)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
   size_t i = 0;
@@ -1912,7 +2224,16 @@ bool blockchain_storage::push_transaction_to_global_outs_index(const transaction
   {
     if (ot.target.type() == typeid(txout_to_key))
     {
-      m_db_outputs.push_back_item(ot.amount, std::pair<crypto::hash, size_t>(tx_id, i));
+      const txout_to_key& otk = boost::get<txout_to_key>(ot.target);
+      output_entry out_entry = AUTO_VAL_INIT(out_entry);
+      out_entry.tx_id = tx_id;
+      out_entry.out_key = otk.key;
+      out_entry.unlock_time = tx.unlock_time;
+      out_entry.keeper_block_height = keeper_block_height;
+      out_entry.out_no = static_cast<uint32_t>(i);
+      out_entry.mix_attr = otk.mix_attr;
+      out_entry.spent = 0;
+      m_db_outputs.push_back_item(ot.amount, out_entry);
       global_indexes.push_back(m_db_outputs.get_item_size(ot.amount) - 1);
     }
     ++i;
@@ -1922,27 +2243,23 @@ bool blockchain_storage::push_transaction_to_global_outs_index(const transaction
 //------------------------------------------------------------------
 size_t blockchain_storage::get_total_transactions()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_db_transactions.size();
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_outs(uint64_t amount, std::list<crypto::public_key>& pkeys)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   uint64_t sz = m_db_outputs.get_item_size(amount);
 
   if (!sz)
     return true;
 
+  std::vector<std::shared_ptr<const outputs_container::t_value_type>> outs;
+  m_db_outputs.get_subitems(amount, 0, sz, outs);
   for (uint64_t i = 0; i != sz; i++)
   {
-    auto out_entry_ptr = m_db_outputs.get_subitem(amount, i);
-
-    auto tx_ptr = m_db_transactions.find(out_entry_ptr->first);
-    CHECK_AND_ASSERT_MES(tx_ptr, false, "transactions outs global index consistency broken: wrong tx id in index");
-    CHECK_AND_ASSERT_MES(tx_ptr->tx.vout.size() > out_entry_ptr->second, false, "transactions outs global index consistency broken: index in tx_outx more then size");
-    CHECK_AND_ASSERT_MES(tx_ptr->tx.vout[out_entry_ptr->second].target.type() == typeid(txout_to_key), false, "transactions outs global index consistency broken: index in tx_outx more then size");
-    pkeys.push_back(boost::get<txout_to_key>(tx_ptr->tx.vout[out_entry_ptr->second].target).key);
+    pkeys.push_back(outs[i]->out_key);
   }
 
   return true;
@@ -1959,8 +2276,8 @@ bool blockchain_storage::pop_transaction_from_global_index(const transaction& tx
       uint64_t sz = m_db_outputs.get_item_size(ot.amount);
       CHECK_AND_ASSERT_MES(sz, false, "transactions outs global index: empty index for amount: " << ot.amount);
       auto back_item = m_db_outputs.get_subitem(ot.amount, sz - 1);
-      CHECK_AND_ASSERT_MES(back_item->first == tx_id, false, "transactions outs global index consistency broken: tx id missmatch");
-      CHECK_AND_ASSERT_MES(back_item->second == i, false, "transactions outs global index consistency broken: in transaction index missmatch");
+      CHECK_AND_ASSERT_MES(back_item->tx_id == tx_id, false, "transactions outs global index consistency broken: tx id missmatch");
+      CHECK_AND_ASSERT_MES(back_item->out_no == i, false, "transactions outs global index consistency broken: in transaction index missmatch");
       m_db_outputs.pop_back_item(ot.amount);
       //do not let to exist empty m_outputs entries - this will broke scratchpad selector
       //if (!it->second.size())
@@ -1989,7 +2306,7 @@ bool blockchain_storage::unprocess_blockchain_tx_extra(const transaction& tx)
 //------------------------------------------------------------------
 bool blockchain_storage::get_alias_info(const std::string& alias, alias_info_base& info)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto al_ptr = m_db_aliases.find(alias);
   if (al_ptr)
   {
@@ -2004,19 +2321,19 @@ bool blockchain_storage::get_alias_info(const std::string& alias, alias_info_bas
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_aliases_count()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_db_aliases.size();
 }
 //------------------------------------------------------------------
 uint64_t blockchain_storage::get_scratchpad_size()
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   return m_scratchpad_wr.get_scratchpad().size() * 32;
 }
 //------------------------------------------------------------------
 bool blockchain_storage::get_all_aliases(std::list<alias_info>& aliases)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   m_db_aliases.enumerate_items([&](uint64_t i, const std::string& alias, const std::list<alias_info_base>& elias_entries)
   {
@@ -2276,7 +2593,7 @@ bool blockchain_storage::add_transaction_from_block(const transaction& tx, const
     return false;
   }
 
-  r = push_transaction_to_global_outs_index(tx, tx_id, ch_e.m_global_output_indexes);
+  r = push_transaction_to_global_outs_index(tx, tx_id, bl_height, ch_e.m_global_output_indexes);
   CHECK_AND_ASSERT_MES(r, false, "failed to return push_transaction_to_global_outs_index tx id " << tx_id);
   PROF_L2_FINISH(push_tx_to_global_index_time_2);
 
@@ -2303,7 +2620,7 @@ bool blockchain_storage::add_transaction_from_block(const transaction& tx, const
 //------------------------------------------------------------------
 bool blockchain_storage::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<uint64_t>& indexs)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   auto tx_ptr = m_db_transactions.find(tx_id);
   if (!tx_ptr)
   {
@@ -2319,7 +2636,7 @@ bool blockchain_storage::get_tx_outputs_gindexs(const crypto::hash& tx_id, std::
 bool blockchain_storage::check_tx_inputs(const transaction& tx, uint64_t& max_used_block_height, crypto::hash& max_used_block_id)
 {
   PROFILE_FUNC("blockchain_storage::check_tx_inputs(tx, max_h, max_id)");
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   bool res = check_tx_inputs(tx, &max_used_block_height);
   if (!res) return false;
   CHECK_AND_ASSERT_MES(max_used_block_height < m_db_blocks.size(), false, "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_db_blocks.size());
@@ -2345,13 +2662,18 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, uint64_t* pmax_u
   return check_tx_inputs(tx, tx_prefix_hash, pmax_used_block_height);
 }
 //------------------------------------------------------------------
-bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height)
+bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height, std::vector<ring_signature_check_job>* pdeferred_checks)
 {
   PROFILE_FUNC("blockchain_storage::check_tx_inputs(tx, prefix_id, max_h)");
   size_t sig_index = 0;
   if (pmax_used_block_height)
     *pmax_used_block_height = 0;
 
+  // ring signatures are checked after all the inputs are resolved: here, on the verifier pool, or by the caller
+  std::vector<ring_signature_check_job> local_checks;
+  std::vector<ring_signature_check_job>& checks = pdeferred_checks ? *pdeferred_checks : local_checks;
+  crypto::hash tx_id = m_is_in_checkpoint_zone ? null_hash : get_transaction_hash(tx);
+
   BOOST_FOREACH(const auto& txin, tx.vin)
   {
     CHECK_AND_ASSERT_MES(txin.type() == typeid(txin_to_key), false, "wrong type id in tx input at blockchain_storage::check_tx_inputs");
@@ -2372,7 +2694,14 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::ha
       CHECK_AND_ASSERT_MES(sig_index < tx.signatures.size(), false, "wrong transaction: not signature entry for input with index= " << sig_index);
       psig = &tx.signatures[sig_index];
     }
-    if (!check_tx_input(in_to_key, tx_prefix_hash, *psig, pmax_used_block_height))
+    ring_signature_check_job* pcheck = NULL;
+    if (!m_is_in_checkpoint_zone)
+    {
+      pcheck = &*checks.insert(checks.end(), ring_signature_check_job());
+      pcheck->tx_id = tx_id;
+      pcheck->input_index = sig_index;
+    }
+    if (!check_tx_input(in_to_key, tx_prefix_hash, *psig, pmax_used_block_height, pcheck))
     {
       LOG_PRINT_L0("Failed to check input #" << sig_index << " for tx " << get_transaction_hash(tx));
       return false;
@@ -2385,6 +2714,16 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::ha
     CHECK_AND_ASSERT_MES(tx.signatures.size() == sig_index, false, "tx signatures count differs from inputs");
   }
 
+  if (!pdeferred_checks)
+  {
+    size_t failed_check_index = 0;
+    if (!m_ring_signature_verifier.verify(local_checks, failed_check_index))
+    {
+      LOG_PRINT_L0("Failed to check ring signature of input #" << local_checks[failed_check_index].input_index << " for tx " << tx_id);
+      return false;
+    }
+  }
+
   return true;
 }
 //------------------------------------------------------------------
@@ -2410,9 +2749,9 @@ bool blockchain_storage::is_tx_spendtime_unlocked(uint64_t unlock_time)
   return false;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height)
+bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height, ring_signature_check_job* pdeferred_check)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
 
   struct outputs_visitor
   {
@@ -2420,22 +2759,16 @@ bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::h
     blockchain_storage& m_bch;
     outputs_visitor(std::vector<crypto::public_key>& results_collector, blockchain_storage& bch) :m_results_collector(results_collector), m_bch(bch)
     {}
-    bool handle_output(const transaction& tx, const tx_out& out)
+    bool handle_output(const output_entry& out_entry)
     {
       //check tx unlock time
-      if (!m_bch.is_tx_spendtime_unlocked(tx.unlock_time))
+      if (!m_bch.is_tx_spendtime_unlocked(out_entry.unlock_time))
       {
-        LOG_PRINT_L0("One of outputs for one of inputs have wrong tx.unlock_time = " << tx.unlock_time);
+        LOG_PRINT_L0("One of outputs for one of inputs have wrong tx.unlock_time = " << out_entry.unlock_time);
         return false;
       }
 
-      if (out.target.type() != typeid(txout_to_key))
-      {
-        LOG_PRINT_L0("Output have wrong type id, which=" << out.target.which());
-        return false;
-      }
-
-      m_results_collector.push_back(boost::get<txout_to_key>(out.target).key);
+      m_results_collector.push_back(out_entry.out_key);
       return true;
     }
   };
@@ -2458,6 +2791,14 @@ bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::h
     return true;
 
   CHECK_AND_ASSERT_MES(sig.size() == output_keys.size(), false, "internal error: tx signatures count=" << sig.size() << " mismatch with outputs keys count for inputs=" << output_keys.size());
+  if (pdeferred_check)
+  {
+    pdeferred_check->prefix_hash = tx_prefix_hash;
+    pdeferred_check->k_image = txin.k_image;
+    pdeferred_check->output_keys.swap(output_keys);
+    pdeferred_check->signatures = sig;
+    return true;
+  }
   return crypto::check_ring_signature(tx_prefix_hash, txin.k_image, output_keys, sig.data());
 }
 //------------------------------------------------------------------
@@ -2502,7 +2843,7 @@ bool blockchain_storage::check_block_timestamp(std::vector<uint64_t> timestamps,
 //------------------------------------------------------------------
 bool blockchain_storage::get_block_for_scratchpad_alt(uint64_t connection_height, uint64_t block_index, std::list<blockchain_storage::blocks_ext_by_hash::iterator>& alt_chain, block & b)
 {
-  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  BLOCKCHAIN_SHARED_REGION_LOCAL();
   if (block_index >= connection_height)
   {
     //take it from alt chain
@@ -2572,10 +2913,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   PROF_L1_START(longhash_calculating_time);
   crypto::hash proof_of_work = null_hash;
 
-  proof_of_work = get_block_longhash(bl, m_db_blocks.size(), [&](uint64_t index) -> crypto::hash
-  {
-    return m_scratchpad_wr.get_scratchpad()[index%m_scratchpad_wr.get_scratchpad().size()];
-  });
+  proof_of_work = get_blob_longhash(get_block_hashing_blob(bl), m_db_blocks.size(), m_scratchpad_wr.get_scratchpad());
 
   if (!check_hash(proof_of_work, current_diffic))
   {
@@ -2626,6 +2964,8 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   PROF_L2_START(process_transactions_time);
   size_t tx_processed_count = 0;
   uint64_t fee_summary = 0;
+  // ring signatures of all the block's transactions are checked at once, after the inputs are resolved
+  std::vector<ring_signature_check_job> ring_signature_checks;
   BOOST_FOREACH(const crypto::hash& tx_id, bl.tx_hashes)
   {
     transaction tx;
@@ -2646,7 +2986,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
       tx.signatures.clear();
     }
 
-    if (!check_tx_inputs(tx))
+    if (!check_tx_inputs(tx, get_transaction_prefix_hash(tx), NULL, &ring_signature_checks))
     {
       LOG_PRINT_L0("Block with id: " << id << "have at least one transaction (id: " << tx_id << ") with wrong inputs.");
       currency::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -2675,6 +3015,21 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   }
   PROF_L2_FINISH(process_transactions_time);
 
+  PROF_L1_START(ring_signatures_check_time);
+  size_t failed_check_index = 0;
+  if (!m_ring_signature_verifier.verify(ring_signature_checks, failed_check_index))
+  {
+    const ring_signature_check_job& failed_check = ring_signature_checks[failed_check_index];
+    LOG_PRINT_L0("Block with id: " << id << "have at least one transaction (id: " << failed_check.tx_id << ") with wrong ring signature in input #" << failed_check.input_index);
+    //all the block's transactions, including the wrong one, go back to the pool
+    purge_block_data_from_blockchain(bl, tx_processed_count);
+    add_block_as_invalid(bl, id);
+    LOG_PRINT_L0("Block with id " << id << " added as invalid becouse of wrong inputs in transactions");
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
+  PROF_L1_FINISH(ring_signatures_check_time);
+
 
   PROF_L2_START(validate_miner_tx_time);
   uint64_t base_reward = 0;
@@ -2744,7 +3099,8 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
     << PROF_L1_STR(", " << print_mcsec_as_ms(block_processing_time))
     << PROF_L1_STR("(" << print_mcsec_as_ms(target_calculating_time))
     << PROF_L1_STR("/" << print_mcsec_as_ms(longhash_calculating_time))
-    << PROF_L1_STR(")ms")
+    << PROF_L1_STR("/" << print_mcsec_as_ms(ring_signatures_check_time))
+    << PROF_L1_STR(")ms, ring signatures: " << ring_signature_checks.size())
     << PROF_L2_STR("  Profiling results (ms): ")
     << PROF_L2_STR_MS(ENDL << "  timestamp_check_time:       ", timestamp_check_time)
     << PROF_L2_STR_MS(ENDL << "  target_calculating_time:    ", target_calculating_time)
@@ -2752,6 +3108,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
     << PROF_L2_STR_MS(ENDL << "  prevalidate_miner_tx_time:  ", prevalidate_miner_tx_time)
     << PROF_L2_STR_MS(ENDL << "  add_miner_tx_time:          ", add_miner_tx_time)
     << PROF_L2_STR_MS(ENDL << "  process_transactions_time:  ", process_transactions_time)
+    << PROF_L2_STR_MS(ENDL << "  ring_signatures_check_time: ", ring_signatures_check_time)
     << PROF_L2_STR_MS(ENDL << "  validate_miner_tx_time:     ", validate_miner_tx_time)
     << PROF_L2_STR_MS(ENDL << "  update_blocks_table_time1:  ", update_blocks_table_time1)
     << PROF_L2_STR_MS(ENDL << "  update_scratchpad_time:     ", update_scratchpad_time)
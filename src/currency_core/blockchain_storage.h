@@ -32,6 +32,7 @@
 #include "scratchpad_helpers.h"
 #include "file_io_utils.h"
 #include "common/db_lmdb_adapter.h"
+#include "ring_signature_verifier.h"
 
 MAKE_POD_C11(crypto::key_image);
 typedef std::pair<crypto::hash, uint64_t> macro_alias_1;
@@ -39,6 +40,10 @@ MAKE_POD_C11(macro_alias_1);
 
 POD_MAKE_HASHABLE(currency, account_public_address);
 
+#define BLOCKCHAIN_SHARED_REGION_LOCAL() blockchain_storage::shared_region_guard blockchain_shared_region_var(*this)
+#define BLOCKCHAIN_SHARED_REGION_BEGIN() { BLOCKCHAIN_SHARED_REGION_LOCAL()
+#define BLOCKCHAIN_SHARED_REGION_END() }
+
 namespace currency
 {
 
@@ -56,15 +61,26 @@ namespace currency
       std::vector<bool> m_spent_flags;
       uint32_t version;
 
-      DEFINE_SERIALIZATION_VERSION(1)
+      DEFINE_SERIALIZATION_VERSION(2)
 
+      // since version 2 tx goes last, so the transaction blob can be served right from the stored entry
       BEGIN_SERIALIZE_OBJECT()
         VERSION_ENTRY(version)
         FIELD(version)
-        FIELDS(tx)
-        FIELD(m_keeper_block_height)
-        FIELD(m_global_output_indexes)
-        FIELD(m_spent_flags)
+        if (version < 2)
+        {
+          FIELDS(tx)
+          FIELD(m_keeper_block_height)
+          FIELD(m_global_output_indexes)
+          FIELD(m_spent_flags)
+        }
+        else
+        {
+          FIELD(m_keeper_block_height)
+          FIELD(m_global_output_indexes)
+          FIELD(m_spent_flags)
+          FIELDS(tx)
+        }
       END_SERIALIZE()
     };
 
@@ -93,7 +109,23 @@ namespace currency
       END_SERIALIZE()
     };
 
-    typedef db::key_to_array_accessor_base<uint64_t, std::pair<crypto::hash, uint64_t>, false>  outputs_container;
+#pragma pack(push, 1)
+    // global outputs index entry: everything needed to use the output as a ring member without loading its transaction
+    struct output_entry
+    {
+      crypto::hash tx_id;
+      crypto::public_key out_key;
+      uint64_t unlock_time;          // transaction's unlock time
+      uint64_t keeper_block_height;
+      uint32_t out_no;               // index in transaction's vout
+      uint8_t mix_attr;
+      uint8_t spent;                 // set only for direct (no mixins) spending, same as transaction_chain_entry::m_spent_flags
+    };
+#pragma pack(pop)
+
+    typedef db::key_to_array_accessor_base<uint64_t, output_entry, false>  outputs_container;
+    // (tx_id, n) pairs, layout used prior to BLOCKCHAIN_OUTPUTS_FORMAT_VERSION 1, kept only for migration
+    typedef db::key_to_array_accessor_base<uint64_t, std::pair<crypto::hash, uint64_t>, false>  legacy_outputs_container;
 
     blockchain_storage(tx_memory_pool& tx_pool);
 
@@ -160,7 +192,7 @@ namespace currency
     bool get_short_chain_history(std::list<crypto::hash>& ids);
     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp);
     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, uint64_t& starter_offset);
-    bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
+    bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
     bool handle_get_objects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp);
     bool handle_get_objects(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
     bool get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res);
@@ -172,8 +204,8 @@ namespace currency
     uint64_t get_aliases_count();
     uint64_t get_scratchpad_size();
     //bool store_blockchain();
-    bool check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height = NULL);
-    bool check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height = NULL, ring_signature_check_job* pdeferred_check = NULL);
+    bool check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height = NULL, std::vector<ring_signature_check_job>* pdeferred_checks = NULL);
     bool check_tx_inputs(const transaction& tx, uint64_t* pmax_used_block_height = NULL);
     bool check_tx_inputs(const transaction& tx, uint64_t& pmax_used_block_height, crypto::hash& max_used_block_id);
     uint64_t get_current_comulative_blocksize_limit();
@@ -190,18 +222,34 @@ namespace currency
     wide_difficulty_type block_difficulty(size_t i);
     bool copy_scratchpad(std::vector<crypto::hash>& dst);//TODO: not the best way, add later update method instead of full copy    
     bool copy_scratchpad_as_blob(std::string& dst);
+    //immutable copy of the scratchpad, shared by all callers until the scratchpad changes, returned without blockchain lock if up to date
+    struct scratchpad_snapshot
+    {
+      uint64_t version;                                           //scratchpad_wrapper::get_version() it was taken at
+      uint64_t height;                                            //top block
+      crypto::hash top_id;
+      std::vector<boost::shared_ptr<const std::string> > pages;  //scratchpad blob by CURRENCY_SCRATCHPAD_SNAPSHOT_PAGE_SIZE parts
+    };
+    typedef boost::shared_ptr<const scratchpad_snapshot> scratchpad_snapshot_ptr;
+    scratchpad_snapshot_ptr get_scratchpad_snapshot();
     bool prune_aged_alt_blocks();
     bool get_transactions_daily_stat(uint64_t& daily_cnt, uint64_t& daily_volume);
+    void get_db_cache_stats(std::map<std::string, db::cache_stats>& stats);
     bool check_keyimages(const std::list<crypto::key_image>& images, std::list<bool>& images_stat);//true - unspent, false - spent
     void initialize_db_solo_options_values();
     bool get_block_extended_info_by_hash(const crypto::hash &h, block_extended_info &blk) const;
     bool get_block_extended_info_by_height(uint64_t h, block_extended_info &blk) const;
+    bool get_block_blob_by_height(uint64_t h, blobdata& blob) const;
+    bool get_transaction_blob(const crypto::hash& tx_id, blobdata& blob) const;
+    // wire blobs are sliced out of the stored db entries as is, without parsing and re-serializing the objects
+    static bool get_block_blob_from_stored_entry(const void* data, size_t size, blobdata& blob);
+    static bool get_transaction_blob_from_stored_entry(const void* data, size_t size, blobdata& blob);
     bool lookfor_donation(const transaction& tx, uint64_t& donation, uint64_t& royalty);
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool get_blocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs)
     {
-      CRITICAL_REGION_LOCAL(m_blockchain_lock);
+      BLOCKCHAIN_SHARED_REGION_LOCAL();
 
       BOOST_FOREACH(const auto& bl_id, block_ids)
       {
@@ -221,7 +269,7 @@ namespace currency
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     bool get_transactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs)const
     {
-      CRITICAL_REGION_LOCAL(m_blockchain_lock);
+      BLOCKCHAIN_SHARED_REGION_LOCAL();
 
       BOOST_FOREACH(const auto& tx_id, txs_ids)
       {
@@ -245,6 +293,43 @@ namespace currency
     void print_blockchain_outs(const std::string& file);
 
   private:
+    // shared access to the blockchain: takes m_blockchain_lock in shared mode and, for the outermost shared region of
+    // the thread, opens read-only db transaction, so all reads within the region see the same db snapshot
+    class shared_region_guard
+    {
+    public:
+      shared_region_guard(const blockchain_storage& bcs)
+        : m_bcs(bcs)
+        , m_db_transaction_started(false)
+      {
+        if (m_bcs.m_blockchain_lock.lock_shared())
+          m_db_transaction_started = m_bcs.m_db.begin_transaction(true);
+      }
+
+      ~shared_region_guard()
+      {
+        if (m_db_transaction_started)
+        {
+          try
+          {
+            m_bcs.m_db.commit_transaction();
+          }
+          catch (...)
+          {
+            LOG_ERROR("failed to commit read-only transaction");
+          }
+        }
+        m_bcs.m_blockchain_lock.unlock_shared();
+      }
+
+    private:
+      shared_region_guard(const shared_region_guard&);
+      shared_region_guard& operator=(const shared_region_guard&);
+
+      const blockchain_storage& m_bcs;
+      bool m_db_transaction_started;
+    };
+
     //-------------- DB containers --------------
     typedef db::key_value_accessor_base<crypto::hash, uint64_t, false> blocks_by_id_index; //typedef std::unordered_map<crypto::hash, size_t> blocks_by_id_index;
     typedef db::key_value_accessor_base<crypto::hash, transaction_chain_entry, true> transactions_container; //typedef std::unordered_map<crypto::hash, transaction_chain_entry> transactions_container;
@@ -266,7 +351,7 @@ namespace currency
 
     //main accessor
     std::shared_ptr<db::lmdb_adapter> m_lmdb_adapter;
-    db::db_bridge_base m_db;
+    mutable db::db_bridge_base m_db; // mutable: read-only transactions are opened from const getters
     //containers
     blocks_container m_db_blocks;
     blocks_by_id_index m_db_blocks_index;
@@ -277,12 +362,16 @@ namespace currency
     db::single_value<uint64_t, uint64_t, solo_options_container> m_db_current_pruned_rs_height;
     db::single_value<uint64_t, std::string, solo_options_container, true> m_db_last_worked_version;
     db::single_value<uint64_t, uint64_t, solo_options_container> m_db_storage_major_compability_version;
+    db::single_value<uint64_t, uint64_t, solo_options_container> m_db_outputs_format_version;
+    db::single_value<uint64_t, uint64_t, solo_options_container> m_db_transactions_format_version;
     outputs_container m_db_outputs;
     aliases_container m_db_aliases;
     address_to_aliases_container m_db_addr_to_alias;
     
     scratchpad_wrapper::scratchpad_container m_db_scratchpad_internal;
     scratchpad_wrapper m_scratchpad_wr;
+    epee::critical_section m_scratchpad_snapshot_lock;
+    scratchpad_snapshot_ptr m_scratchpad_snapshot;
 
 
     // state members 
@@ -301,9 +390,10 @@ namespace currency
     checkpoints m_checkpoints;
 
     epee::file_io_utils::native_filesystem_handle m_locker_file;
+    ring_signature_verifier m_ring_signature_verifier;
 
     // mutable members
-    mutable critical_section m_blockchain_lock; // TODO: add here reader/writer lock
+    mutable epee::recursive_shared_critical_section m_blockchain_lock; // exclusive for chain modifications, shared for read-only queries
     mutable critical_section m_exclusive_batch_lock; // TODO: add here reader/writer lock
     std::atomic<bool> m_exclusive_batch_active;
 
@@ -322,10 +412,14 @@ namespace currency
     bool validate_transaction(const block& b, uint64_t height, const transaction& tx);
     bool rollback_blockchain_switching(std::list<block>& original_chain, size_t rollback_height);
     bool add_transaction_from_block(const transaction& tx, const crypto::hash& tx_id, const crypto::hash& bl_id, uint64_t bl_height);
-    bool push_transaction_to_global_outs_index(const transaction& tx, const crypto::hash& tx_id, std::vector<uint64_t>& global_indexes);
+    bool push_transaction_to_global_outs_index(const transaction& tx, const crypto::hash& tx_id, uint64_t keeper_block_height, std::vector<uint64_t>& global_indexes);
+    bool migrate_outputs_to_output_entries();
+    bool migrate_transactions_format();
+    bool get_block_complete_entry(uint64_t h, block_complete_entry& e) const;
     bool pop_transaction_from_global_index(const transaction& tx, const crypto::hash& tx_id);
     bool get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count);
     bool add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i, uint64_t mix_count, bool use_only_forced_to_mix = false);
+    bool add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i, const outputs_container::t_value_type& out_entry, uint64_t mix_count, bool use_only_forced_to_mix = false);
     bool is_tx_spendtime_unlocked(uint64_t unlock_time);
     bool add_block_as_invalid(const block& bl, const crypto::hash& h);
     bool add_block_as_invalid(const block_extended_info& bei, const crypto::hash& h);
@@ -362,7 +456,7 @@ namespace currency
   template<class visitor_t>
   bool blockchain_storage::scan_outputkeys_for_indexes(const txin_to_key& tx_in_to_key, visitor_t& vis, uint64_t* pmax_related_block_height)
   {
-    CRITICAL_REGION_LOCAL(m_blockchain_lock);
+    BLOCKCHAIN_SHARED_REGION_LOCAL();
 
     uint64_t outs_count_for_amount = m_db_outputs.get_item_size(tx_in_to_key.amount);
 
@@ -373,41 +467,36 @@ namespace currency
 
     //std::vector<std::pair<crypto::hash, size_t> >& amount_outs_vec = it->second;
 
-    size_t count = 0;
     BOOST_FOREACH(uint64_t i, absolute_offsets)
     {
-      crypto::hash tx_id = null_hash;
-      size_t n = 0;
       if (i >= outs_count_for_amount)
       {
         LOG_ERROR("Wrong index in transaction inputs: " << i << ", expected maximum " << outs_count_for_amount - 1);
         return false;
       }
-      tx_id = m_db_outputs.get_subitem(tx_in_to_key.amount, i)->first;
-      n = m_db_outputs.get_subitem(tx_in_to_key.amount, i)->second;
+    }
+    std::vector<std::shared_ptr<const outputs_container::t_value_type>> outs;
+    m_db_outputs.get_subitems(tx_in_to_key.amount, std::vector<size_t>(absolute_offsets.begin(), absolute_offsets.end()), outs);
 
+    for (size_t k = 0; k != absolute_offsets.size(); ++k)
+    {
+      const output_entry& out_entry = *outs[k];
 
-      auto tx_ptr = m_db_transactions.find(tx_id);
-      CHECK_AND_ASSERT_MES(tx_ptr, false, "Wrong transaction id in output indexes: " << string_tools::pod_to_hex(tx_id));
-      CHECK_AND_ASSERT_MES(n < tx_ptr->tx.vout.size(), false,
-        "Wrong index in transaction outputs: " << n << ", expected less then " << tx_ptr->tx.vout.size());
       //check mix_attr
+      if (out_entry.mix_attr > 1)
+        CHECK_AND_ASSERT_MES(tx_in_to_key.key_offsets.size() >= out_entry.mix_attr, false, "transaction out[" << k << "] is marked to be used minimum with " << static_cast<uint32_t>(out_entry.mix_attr) << "parts in ring signature, but input used only " << tx_in_to_key.key_offsets.size());
+      else if (out_entry.mix_attr == CURRENCY_TO_KEY_OUT_FORCED_NO_MIX)
+        CHECK_AND_ASSERT_MES(tx_in_to_key.key_offsets.size() == 1, false, "transaction out[" << k << "] is marked to be used without mixins in ring signature, but input used is " << tx_in_to_key.key_offsets.size());
 
-      CHECKED_GET_SPECIFIC_VARIANT(tx_ptr->tx.vout[n].target, const txout_to_key, outtk, false);
-      if (outtk.mix_attr > 1)
-        CHECK_AND_ASSERT_MES(tx_in_to_key.key_offsets.size() >= outtk.mix_attr, false, "transaction out[" << count << "] is marked to be used minimum with " << static_cast<uint32_t>(outtk.mix_attr) << "parts in ring signature, but input used only " << tx_in_to_key.key_offsets.size());
-      else if (outtk.mix_attr == CURRENCY_TO_KEY_OUT_FORCED_NO_MIX)
-        CHECK_AND_ASSERT_MES(tx_in_to_key.key_offsets.size() == 1, false, "transaction out[" << count << "] is marked to be used without mixins in ring signature, but input used is " << tx_in_to_key.key_offsets.size());
-
-      if (!vis.handle_output(tx_ptr->tx, tx_ptr->tx.vout[n]))
+      if (!vis.handle_output(out_entry))
       {
-        LOG_PRINT_L0("Failed to handle_output for output id = " << tx_id << ", no " << n);
+        LOG_PRINT_L0("Failed to handle_output for output id = " << out_entry.tx_id << ", no " << out_entry.out_no);
         return false;
       }
       if (pmax_related_block_height)
       {
-        if (*pmax_related_block_height < tx_ptr->m_keeper_block_height)
-          *pmax_related_block_height = tx_ptr->m_keeper_block_height;
+        if (*pmax_related_block_height < out_entry.keeper_block_height)
+          *pmax_related_block_height = out_entry.keeper_block_height;
       }
     }
 
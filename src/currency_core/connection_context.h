@@ -23,11 +23,12 @@ namespace currency
     };
 
     state m_state;
-    std::list<crypto::hash> m_needed_objects;
-    std::unordered_set<crypto::hash> m_requested_objects;
     uint64_t m_remote_blockchain_height;
     uint64_t m_last_response_height;
     epee::copyable_atomic m_callback_request_count; //in debug purpose: problem with double callback rise
+    uint64_t m_remote_capabilities;
+    std::string m_pending_block;                    //compact block, waiting for requested transactions
+    uint32_t m_pending_block_hop;
     //size_t m_score;  TODO: add score calculations
   };
 
@@ -165,44 +165,56 @@ namespace currency
    crypto::hash tx_hash = tx_hash_;
    if (tx_hash == null_hash)
      tx_hash = get_transaction_hash(tx);
-   CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
   tvc = boost::value_initialized<tx_verification_context>();
-  //want to process all transactions sequentially
-  if (!check_tx_syntax(tx))
+  //transactions are verified concurrently, tx_memory_pool serializes only the insertion
+  if (!prevalidate_tx(tx, tx_hash, keeped_by_block))
   {
-    LOG_PRINT_L0("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " syntax, rejected");
     tvc.m_verifivation_failed = true;
     return false;
   }
 
-  if (!check_tx_semantic(tx, keeped_by_block))
-  {
-    LOG_PRINT_L0("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected");
-    tvc.m_verifivation_failed = true;
-    return false;
-  }
-
-  bool r = add_new_tx(tx, tx_hash, tx_hash, tvc, keeped_by_block);
-  if (tvc.m_verifivation_failed)
-  {
-    LOG_PRINT_RED_L0("Transaction verification failed: " << tx_hash);
-  }
-  else if (tvc.m_verifivation_impossible)
-  {
-    LOG_PRINT_RED_L0("Transaction verification impossible: " << tx_hash);
-  }
-
+  bool r = add_prevalidated_tx(tx, tx_hash, tvc, keeped_by_block);
   if (tvc.m_added_to_pool)
     LOG_PRINT_L1("tx added: " << tx_hash);
   return r;
 
 }
   //-----------------------------------------------------------------------------------------------
+  bool core::prevalidate_tx(const transaction& tx, const crypto::hash& tx_hash, bool keeped_by_block)
+  {
+    if (!check_tx_syntax(tx))
+    {
+      LOG_PRINT_L0("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " syntax, rejected");
+      return false;
+    }
+    //doesn't touch blockchain for transactions keeped by block
+    if (!check_tx_semantic(tx, keeped_by_block))
+    {
+      LOG_PRINT_L0("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected");
+      return false;
+    }
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::add_prevalidated_tx(const transaction& tx, const crypto::hash& tx_hash, tx_verification_context& tvc, bool keeped_by_block)
+  {
+    PROFILE_FUNC("core::add_prevalidated_tx");
+    tvc = boost::value_initialized<tx_verification_context>();
+    bool r = add_new_tx(tx, tx_hash, tx_hash, tvc, keeped_by_block);
+    if (tvc.m_verifivation_failed)
+    {
+      LOG_PRINT_RED_L0("Transaction verification failed: " << tx_hash);
+    }
+    else if (tvc.m_verifivation_impossible)
+    {
+      LOG_PRINT_RED_L0("Transaction verification impossible: " << tx_hash);
+    }
+    return r;
+  }
+  //-----------------------------------------------------------------------------------------------
 bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, bool keeped_by_block)
   {
     tvc = boost::value_initialized<tx_verification_context>();
-    //want to process all transactions sequentially
-    CRITICAL_REGION_LOCAL(m_incoming_tx_lock);
 
     if(tx_blob.size() > get_max_tx_size())
     {
@@ -364,7 +376,7 @@ bool core::handle_incoming_tx(const blobdata& tx_blob, tx_verification_context&
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, resp);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
+  bool core::find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count)
   {
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, blocks, total_height, start_height, max_count);
   }
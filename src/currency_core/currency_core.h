@@ -35,6 +35,9 @@ namespace currency
      bool on_idle();
      bool handle_incoming_tx(const blobdata& tx_blob, tx_verification_context& tvc, bool keeped_by_block);
      bool handle_incoming_tx(const transaction & tx, tx_verification_context& tvc, bool keeped_by_block, const crypto::hash& tx_hash = null_hash);
+     //context free checks, safe to call from any thread; with add_prevalidated_tx it splits handle_incoming_tx for blocks import pipeline
+     bool prevalidate_tx(const transaction& tx, const crypto::hash& tx_hash, bool keeped_by_block);
+     bool add_prevalidated_tx(const transaction& tx, const crypto::hash& tx_hash, tx_verification_context& tvc, bool keeped_by_block);
      bool handle_incoming_block(const blobdata& block_blob, block_verification_context& bvc, bool update_miner_blocktemplate = true);
      bool handle_incoming_block(const block& b, block_verification_context& bvc, bool update_miner_blocktemplate = true);
      i_currency_protocol* get_protocol(){return m_pprotocol;}
@@ -80,7 +83,7 @@ namespace currency
      bool have_block(const crypto::hash& id);
      bool get_short_chain_history(std::list<crypto::hash>& ids);
      bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp);
-     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<std::pair<block, std::list<transaction> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
+     bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, std::list<block_complete_entry>& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count);
      bool get_stat_info(core_stat_info& st_inf);
      bool get_backward_blocks_sizes(uint64_t from_height, std::vector<size_t>& sizes, size_t count);
      bool get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<uint64_t>& indexs);
@@ -122,7 +125,6 @@ namespace currency
      tx_memory_pool m_mempool;
      blockchain_storage m_blockchain_storage;
      i_currency_protocol* m_pprotocol;
-     critical_section m_incoming_tx_lock;
      //m_miner and m_miner_addres are probably temporary here
      miner m_miner;
      account_public_address m_miner_address;
@@ -844,13 +844,42 @@ namespace currency
   crypto::hash get_blob_longhash(const blobdata& bd, uint64_t height, const std::vector<crypto::hash>& scratchpad)
   {
     crypto::hash h = null_hash;
-    get_blob_longhash(bd, h, height, [&](uint64_t index) -> const crypto::hash&
-    {
-      return scratchpad[index%scratchpad.size()];
-    });
+    get_blob_longhash(bd, h, height, scratchpad.data(), scratchpad.size());
     return h;
   }
   //---------------------------------------------------------------
+  bool get_blob_longhash(const blobdata& bd, crypto::hash& res, uint64_t height, const crypto::hash* pscratchpad, uint64_t scratchpad_size)
+  {
+    if(!height)
+      return get_blob_longhash(bd, res, height, [](uint64_t) -> const crypto::hash& { return null_hash; });
+
+    CHECK_AND_ASSERT_MES(scratchpad_size, false, "empty scratchpad for height " << height);
+    crypto::wild_keccak_dbl<crypto::mul_f>(reinterpret_cast<const uint8_t*>(bd.data()), bd.size(), reinterpret_cast<uint8_t*>(&res), sizeof(res), crypto::scratchpad_mixer(pscratchpad, scratchpad_size));
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool get_blobs_longhashes(const std::vector<blobdata>& blobs, std::vector<crypto::hash>& res, uint64_t height, const crypto::hash* pscratchpad, uint64_t scratchpad_size)
+  {
+    res.resize(blobs.size());
+    if(!height || blobs.size() == 1)
+    {
+      for(size_t i = 0; i != blobs.size(); i++)
+        CHECK_AND_ASSERT_MES(get_blob_longhash(blobs[i], res[i], height, pscratchpad, scratchpad_size), false, "failed to get blob longhash");
+      return true;
+    }
+
+    CHECK_AND_ASSERT_MES(scratchpad_size, false, "empty scratchpad for height " << height);
+    std::vector<const uint8_t*> pblobs(blobs.size());
+    for(size_t i = 0; i != blobs.size(); i++)
+    {
+      CHECK_AND_ASSERT_MES(blobs[i].size() == blobs[0].size(), false, "blobs of different sizes can't be hashed together");
+      pblobs[i] = reinterpret_cast<const uint8_t*>(blobs[i].data());
+    }
+    bool r = crypto::wild_keccak_dbl_lanes(pblobs.data(), blobs[0].size(), res.data(), blobs.size(), crypto::scratchpad_mixer(pscratchpad, scratchpad_size));
+    CHECK_AND_ASSERT_MES(r, false, "wrong blobs count to hash together: " << blobs.size());
+    return true;
+  }
+  //---------------------------------------------------------------
   crypto::hash get_blob_longhash_opt(const std::string& blob, const std::vector<crypto::hash>& scratchpad)
   {
     if(!scratchpad.size())
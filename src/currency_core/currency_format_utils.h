@@ -221,6 +221,8 @@ namespace currency
   bool set_payment_id_to_tx_extra(std::vector<uint8_t>& extra, const payment_id_t& payment_id);
   bool get_payment_id_from_tx_extra(const transaction& tx, payment_id_t& payment_id);
   crypto::hash get_blob_longhash(const blobdata& bd, uint64_t height, const std::vector<crypto::hash>& scratchpad);
+  bool get_blob_longhash(const blobdata& bd, crypto::hash& res, uint64_t height, const crypto::hash* pscratchpad, uint64_t scratchpad_size);
+  bool get_blobs_longhashes(const std::vector<blobdata>& blobs, std::vector<crypto::hash>& res, uint64_t height, const crypto::hash* pscratchpad, uint64_t scratchpad_size);
   crypto::hash get_blob_longhash_opt(const blobdata& bd, const std::vector<crypto::hash>& scratchpad);
 
   void print_currency_details();
@@ -304,12 +306,43 @@ namespace currency
     return r;
   }
   //---------------------------------------------------------------
+  // read-only streambuf over external memory, lets binary_archive parse a blob in place, without copying it into a stringstream
+  class blob_view_streambuf : public std::streambuf
+  {
+  public:
+    blob_view_streambuf(const void* p_data, size_t size)
+    {
+      char* p = static_cast<char*>(const_cast<void*>(p_data));
+      setg(p, p, p + size);
+    }
+
+  protected:
+    virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which = std::ios_base::in) override
+    {
+      if (!(which & std::ios_base::in))
+        return pos_type(off_type(-1));
+
+      char* base = dir == std::ios_base::beg ? eback() : (dir == std::ios_base::cur ? gptr() : egptr());
+      off_type new_offset = (base - eback()) + off;
+      if (new_offset < 0 || new_offset > egptr() - eback())
+        return pos_type(off_type(-1));
+
+      setg(eback(), eback() + new_offset, egptr());
+      return pos_type(new_offset);
+    }
+
+    virtual pos_type seekpos(pos_type pos, std::ios_base::openmode which = std::ios_base::in) override
+    {
+      return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+  };
+  //---------------------------------------------------------------
   template<class t_object>
-  bool t_unserializable_object_from_blob(t_object& to, const blobdata& b_blob)
+  bool t_unserializable_object_from_blob(t_object& to, const void* p_blob, size_t blob_size)
   {
-    std::stringstream ss;
-    ss << b_blob;
-    binary_archive<false> ba(ss);
+    blob_view_streambuf buf(p_blob, blob_size);
+    std::istream is(&buf);
+    binary_archive<false> ba(is);
     bool r = ::serialization::serialize(ba, to);
     CHECK_AND_ASSERT_MES(r, false, "Failed to unserialize object from blob: " << typeid(to).name());
 
@@ -317,6 +350,12 @@ namespace currency
   }
   //---------------------------------------------------------------
   template<class t_object>
+  bool t_unserializable_object_from_blob(t_object& to, const blobdata& b_blob)
+  {
+    return t_unserializable_object_from_blob(to, b_blob.data(), b_blob.size());
+  }
+  //---------------------------------------------------------------
+  template<class t_object>
   blobdata t_serializable_object_to_blob(const t_object& to)
   {
     blobdata b;
@@ -35,6 +35,7 @@ namespace currency
     const command_line::arg_descriptor<std::string>   arg_extra_messages =     {"extra-messages-file", "Specify file for extra messages to include into coinbase transactions", "", true};
     const command_line::arg_descriptor<std::string>   arg_start_mining =       {"start-mining", "Specify wallet address to mining for", "", true};
     const command_line::arg_descriptor<uint32_t>      arg_mining_threads =     {"mining-threads", "Specify mining threads count", 0, true};
+    const command_line::arg_descriptor<uint32_t>      arg_mining_lanes =       {"mining-lanes", "Specify how many nonces every mining thread hashes together: 1, 2, 4 or 8 (by default chosen by cpu features)", 0, true};
     const command_line::arg_descriptor<std::string>   arg_set_donation_mode =  {"donation-vote", "Select one of two options for donations vote: \"true\"(to vote fore donation) or \"false\"(to vote against)", "", true};
   }
 
@@ -49,6 +50,7 @@ namespace currency
     m_height(0),
     m_pausers_count(0), 
     m_threads_total(0),
+    m_lanes_count(crypto::get_wild_keccak_default_lanes_count()),
     m_starter_nonce(0), 
     m_do_print_hashrate(false),
     m_do_mining(false),
@@ -174,6 +176,7 @@ namespace currency
     command_line::add_arg(desc, arg_extra_messages);
     command_line::add_arg(desc, arg_start_mining);
     command_line::add_arg(desc, arg_mining_threads);
+    command_line::add_arg(desc, arg_mining_lanes);
     command_line::add_arg(desc, arg_set_donation_mode);    
   }
   //-----------------------------------------------------------------------------------------------------
@@ -214,6 +217,12 @@ namespace currency
       LOG_PRINT_L0("Loaded " << m_extra_messages.size() << " extra messages, current index " << m_config.current_extra_message_index);
     }
 
+    if(command_line::has_arg(vm, arg_mining_lanes) && command_line::get_arg(vm, arg_mining_lanes))
+    {
+      m_lanes_count = command_line::get_arg(vm, arg_mining_lanes);
+      CHECK_AND_ASSERT_MES(m_lanes_count == 1 || m_lanes_count == 2 || m_lanes_count == 4 || m_lanes_count == 8, false, "wrong mining lanes count: " << m_lanes_count);
+    }
+
     if(command_line::has_arg(vm, arg_start_mining))
     {
       if(!currency::get_account_address_from_str(m_mine_address, command_line::get_arg(vm, arg_start_mining)))
@@ -301,7 +310,7 @@ namespace currency
     for(size_t i = 0; i != threads_count; i++)
       m_threads.push_back(boost::thread(boost::bind(&miner::worker_thread, this)));
 
-    LOG_PRINT_L0("Mining has started with " << threads_count << " threads, good luck!" )
+    LOG_PRINT_L0("Mining has started with " << threads_count << " threads, " << m_lanes_count << " nonces per thread at once" << (crypto::is_wild_keccak_x4_available() ? " (AVX2)" : "") << ", good luck!" )
     return true;
   }
   //-----------------------------------------------------------------------------------------------------
@@ -385,7 +394,9 @@ namespace currency
     wide_difficulty_type local_diff = 0;
     uint32_t local_template_ver = 0;
     block b;
-    blobdata block_blob;
+    const size_t lanes_count = m_lanes_count;
+    std::vector<blobdata> blobs(lanes_count);
+    std::vector<crypto::hash> hashes(lanes_count);
 
     //for now have a copy of scratchpad for every thread
     //temporary solution(to avoid slow synchronization while mining), will be changed in few weeks to use one 
@@ -402,7 +413,7 @@ namespace currency
       {        
         CRITICAL_REGION_BEGIN(m_template_lock);
         b = m_template;
-        block_blob = get_block_hashing_blob(b);
+        blobs.assign(lanes_count, get_block_hashing_blob(b));
         local_diff = m_diffic;
         height = m_height;
         CRITICAL_REGION_END();
@@ -417,24 +428,27 @@ namespace currency
         continue;
       }
 
-      *reinterpret_cast<uint64_t*>(&block_blob[1]) = nonce;
-      crypto::hash h;
+      //lanes take nonces of this thread one after another: nonce, nonce + m_threads_total, ...
+      for(size_t lane = 0; lane != lanes_count; lane++)
+        *reinterpret_cast<uint64_t*>(&blobs[lane][1]) = nonce + lane*m_threads_total;
       SHARED_CRITICAL_REGION_BEGIN(m_scratchpad_access);
 #if defined(WIN32)
-      h = get_blob_longhash_opt(block_blob, m_scratchpad);
+      for(size_t lane = 0; lane != lanes_count; lane++)
+        hashes[lane] = get_blob_longhash_opt(blobs[lane], m_scratchpad);
 #else
-      get_blob_longhash(block_blob, h, height, [&](uint64_t index) -> crypto::hash&
-      {
-        return m_scratchpad[index%m_scratchpad.size()];
-      });
+      get_blobs_longhashes(blobs, hashes, height, m_scratchpad.data(), m_scratchpad.size());
 #endif
 
       CRITICAL_REGION_END();
 
-      if(check_hash(h, local_diff))
+      size_t lucky_lane = 0;
+      while(lucky_lane != lanes_count && !check_hash(hashes[lucky_lane], local_diff))
+        ++lucky_lane;
+
+      if(lucky_lane != lanes_count)
       {
         //we lucky!
-        b.nonce = nonce;
+        b.nonce = nonce + lucky_lane*m_threads_total;
         //move alias info to temp var 
         alias_info ai_local = AUTO_VAL_INIT(ai_local);
         CRITICAL_REGION_BEGIN(m_aliace_to_apply_in_block_lock);
@@ -468,8 +482,8 @@ namespace currency
           }
         }
       }
-      nonce+=m_threads_total;
-      ++m_hashes;
+      nonce+=m_threads_total*lanes_count;
+      m_hashes += lanes_count;
     }
     LOG_PRINT_L0("Miner thread stopped ["<< th_local_index << "]");
     return true;
@@ -102,6 +102,7 @@ namespace currency
     uint64_t m_height;
     volatile uint32_t m_thread_index; 
     volatile uint32_t m_threads_total;
+    size_t m_lanes_count;                   // nonces hashed together by every thread
     std::atomic<int32_t> m_pausers_count;
     ::critical_section m_miners_count_lock;
 
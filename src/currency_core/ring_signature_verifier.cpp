@@ -0,0 +1,136 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "include_base_utils.h"
+#include "ring_signature_verifier.h"
+
+namespace currency
+{
+  //-----------------------------------------------------------------------------------------------
+  ring_signature_verifier::ring_signature_verifier()
+    : m_stop(false)
+    , m_pjobs(nullptr)
+    , m_batch_number(0)
+    , m_busy_workers(0)
+    , m_next_job(0)
+    , m_failed_job_index(0)
+  {}
+  //-----------------------------------------------------------------------------------------------
+  ring_signature_verifier::~ring_signature_verifier()
+  {
+    deinit();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool ring_signature_verifier::init(size_t threads_count)
+  {
+    deinit();
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_stop = false;
+    for (size_t i = 1; i < threads_count; i++)
+      m_workers.push_back(boost::thread(boost::bind(&ring_signature_verifier::worker_thread, this, m_batch_number)));
+    LOG_PRINT_L0("Ring signature verification threads: " << threads_count);
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void ring_signature_verifier::deinit()
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      m_stop = true;
+    }
+    m_batch_started.notify_all();
+    BOOST_FOREACH(boost::thread& th, m_workers)
+      th.join();
+    m_workers.clear();
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool ring_signature_verifier::verify_job(const ring_signature_check_job& job)
+  {
+    CHECK_AND_ASSERT_MES(job.signatures.size() == job.output_keys.size(), false, "internal error: tx signatures count=" << job.signatures.size() << " mismatch with outputs keys count for inputs=" << job.output_keys.size());
+    return crypto::check_ring_signature(job.prefix_hash, job.k_image, job.output_keys, job.signatures.data());
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool ring_signature_verifier::verify(const std::vector<ring_signature_check_job>& jobs, size_t& failed_job_index)
+  {
+    failed_job_index = jobs.size();
+    if (jobs.empty())
+      return true;
+
+    boost::unique_lock<boost::mutex> verify_lock(m_verify_lock, boost::try_to_lock);
+    if (!verify_lock.owns_lock())
+    {
+      // the pool is busy with another batch, do not wait for it
+      for (size_t i = 0; i != jobs.size(); i++)
+      {
+        if (!verify_job(jobs[i]))
+        {
+          failed_job_index = i;
+          return false;
+        }
+      }
+      return true;
+    }
+
+    m_next_job = 0;
+    m_failed_job_index = jobs.size();
+    if (m_workers.empty() || jobs.size() == 1)
+    {
+      m_pjobs = &jobs;
+      process_jobs();
+    }
+    else
+    {
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        m_pjobs = &jobs;
+        ++m_batch_number;
+        m_busy_workers = m_workers.size();
+      }
+      m_batch_started.notify_all();
+      process_jobs();
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      while (m_busy_workers != 0)
+        m_batch_finished.wait(lock);
+    }
+    m_pjobs = nullptr;
+
+    failed_job_index = m_failed_job_index;
+    return failed_job_index == jobs.size();
+  }
+  //-----------------------------------------------------------------------------------------------
+  void ring_signature_verifier::process_jobs()
+  {
+    const std::vector<ring_signature_check_job>& jobs = *m_pjobs;
+    for (size_t i = m_next_job++; i < jobs.size(); i = m_next_job++)
+    {
+      if (i > m_failed_job_index)
+        break; // the batch is failed already
+      if (!verify_job(jobs[i]))
+      {
+        size_t prev = m_failed_job_index;
+        while (i < prev && !m_failed_job_index.compare_exchange_weak(prev, i));
+      }
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  void ring_signature_verifier::worker_thread(uint64_t processed_batch_number)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    while (true)
+    {
+      while (!m_stop && processed_batch_number == m_batch_number)
+        m_batch_started.wait(lock);
+      if (m_stop)
+        return;
+      processed_batch_number = m_batch_number;
+
+      lock.unlock();
+      process_jobs();
+      lock.lock();
+
+      if (--m_busy_workers == 0)
+        m_batch_finished.notify_one();
+    }
+  }
+}
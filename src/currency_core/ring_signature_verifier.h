@@ -0,0 +1,64 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/foreach.hpp>
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+
+namespace currency
+{
+  // everything needed to check one input's ring signature, collected under the blockchain lock
+  struct ring_signature_check_job
+  {
+    crypto::hash tx_id;
+    size_t input_index;
+    crypto::hash prefix_hash;
+    crypto::key_image k_image;
+    std::vector<crypto::public_key> output_keys;
+    std::vector<crypto::signature> signatures;
+  };
+
+  /************************************************************************/
+  /* Checks ring signatures on a fixed pool of worker threads; the caller */
+  /* thread takes part in the work too.                                   */
+  /************************************************************************/
+  class ring_signature_verifier
+  {
+  public:
+    ring_signature_verifier();
+    ~ring_signature_verifier();
+
+    // threads_count includes the caller thread, so 1 means no worker threads at all
+    bool init(size_t threads_count);
+    void deinit();
+    size_t get_threads_count() const { return m_workers.size() + 1; }
+
+    // blocks until all the jobs are checked; on failure failed_job_index is the smallest index of failed jobs
+    bool verify(const std::vector<ring_signature_check_job>& jobs, size_t& failed_job_index);
+    static bool verify_job(const ring_signature_check_job& job);
+
+  private:
+    void worker_thread(uint64_t processed_batch_number);
+    void process_jobs();
+
+    boost::mutex m_verify_lock;                 // one batch at a time
+    boost::mutex m_lock;
+    boost::condition_variable m_batch_started;
+    boost::condition_variable m_batch_finished;
+    std::vector<boost::thread> m_workers;
+    bool m_stop;
+
+    // current batch
+    const std::vector<ring_signature_check_job>* m_pjobs;
+    uint64_t m_batch_number;
+    size_t m_busy_workers;
+    std::atomic<size_t> m_next_job;
+    std::atomic<size_t> m_failed_job_index;
+  };
+}
@@ -11,7 +11,7 @@
 
 namespace currency
 {
-  scratchpad_wrapper::scratchpad_wrapper(scratchpad_container& m_db_scratchpad) :m_rdb_scratchpad(m_db_scratchpad)
+  scratchpad_wrapper::scratchpad_wrapper(scratchpad_container& m_db_scratchpad) :m_rdb_scratchpad(m_db_scratchpad), m_version(0)
   {}
 
 
@@ -44,6 +44,7 @@ namespace currency
       PROF_L1_FINISH(cache_load_timer);
       LOG_PRINT_MAGENTA("Scratchpad loaded from db OK (" << m_scratchpad_cache.size() << " elements, " << (m_scratchpad_cache.size() * 32) / 1024 << " KB)" << PROF_L1_STR_MS_STR(" in ", cache_load_timer, " ms"), LOG_LEVEL_0);
     }
+    ++m_version;
 
     return true;
   }
@@ -70,6 +71,7 @@ namespace currency
   {
     m_scratchpad_cache.clear();
     m_rdb_scratchpad.clear();
+    ++m_version;
   }
 
   const std::vector<crypto::hash>& scratchpad_wrapper::get_scratchpad()
@@ -96,6 +98,7 @@ namespace currency
       PROFILE_FUNC_SECOND("scratchpad_wrapper::push_block_scratchpad_data-db");
       res &= currency::push_block_scratchpad_data(b, m_rdb_scratchpad);
     }
+    ++m_version;
     
 #ifdef SELF_VALIDATE_SCRATCHPAD
     std::vector<crypto::hash> scratchpad_cache;
@@ -115,6 +118,7 @@ namespace currency
   {
     bool res = currency::pop_block_scratchpad_data(b, m_scratchpad_cache);
     res &= currency::pop_block_scratchpad_data(b, m_rdb_scratchpad);
+    ++m_version;
     return res;
   }
 
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include "currency_basic.h"
 #include "common/util.h"
 #include "currency_core/currency_format_utils.h"
@@ -27,10 +28,13 @@ namespace currency
     void set_scratchpad(const std::vector<crypto::hash>& sc);
     bool push_block_scratchpad_data(const block& b);
     bool pop_block_scratchpad_data(const block& b);
+    //changed on every scratchpad update, lets copies of it be checked without locking
+    uint64_t get_version() const { return m_version; }
 
   private:
     std::vector<crypto::hash> m_scratchpad_cache;
     scratchpad_container& m_rdb_scratchpad;
+    std::atomic<uint64_t> m_version;
     std::string m_config_folder;
   };
   //------------------------------------------------------------------
@@ -24,9 +24,20 @@ DISABLE_VS_WARNINGS(4244 4345 4503) //'boost::foreach_detail_::or_' : decorated
 namespace currency
 {
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(blockchain_storage& bchs): m_blockchain(bchs)
+  tx_memory_pool::tx_memory_pool(blockchain_storage& bchs): m_blockchain(bchs), m_ready_cache_top_id(null_hash)
   {
 
+  }
+  //---------------------------------------------------------------------------------
+  bool tx_memory_pool::fee_rate_greater::operator()(const transactions_container::value_type* a, const transactions_container::value_type* b) const
+  {
+    uint64_t a_hi, a_lo = mul128(a->second.fee, b->second.blob_size, &a_hi);
+    uint64_t b_hi, b_lo = mul128(b->second.fee, a->second.blob_size, &b_hi);
+    if (a_hi != b_hi)
+      return a_hi > b_hi;
+    if (a_lo != b_lo)
+      return a_lo > b_lo;
+    return memcmp(&a->first, &b->first, sizeof(crypto::hash)) < 0;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const transaction &tx, const crypto::hash &id, tx_verification_context& tvc, bool kept_by_block)
@@ -82,10 +93,30 @@ namespace currency
       }
     }
 
+    //signatures are checked without holding the pool, so transactions from different connections are verified in parallel
     crypto::hash max_used_block_id = null_hash;
     uint64_t max_used_block_height = 0;
+    crypto::hash checked_top_id = m_blockchain.get_top_block_id();
     bool ch_inp_res = m_blockchain.check_tx_inputs(tx, max_used_block_height, max_used_block_id);
     CRITICAL_REGION_LOCAL(m_transactions_lock);
+    //the same transaction could have been added meanwhile by another thread
+    if(m_transactions.count(id))
+    {
+      LOG_PRINT_L2("tx " << id << " already have transaction in tx_pool");
+      return true;
+    }
+    if(!kept_by_block && have_tx_keyimges_as_spent(tx))
+    {
+      LOG_ERROR("Transaction with id= " << id << " used key images spent by other transaction in pool");
+      tvc.m_verifivation_failed = true;
+      return false;
+    }
+    //blocks are added with the pool locked, so the tip can't move any more until the transaction is inserted
+    if(m_blockchain.get_top_block_id() != checked_top_id)
+    {
+      LOG_PRINT_L2("tx " << id << " inputs checked against outdated top block, checking again");
+      ch_inp_res = m_blockchain.check_tx_inputs(tx, max_used_block_height, max_used_block_id);
+    }
     if(!ch_inp_res)
     {
       if(kept_by_block)
@@ -100,6 +131,7 @@ namespace currency
         txd_p.first->second.max_used_block_height = 0;
         txd_p.first->second.kept_by_block = kept_by_block;
         txd_p.first->second.receive_time = time(nullptr);
+        m_fee_index.insert(&*txd_p.first);
         tvc.m_verifivation_impossible = true;
         tvc.m_added_to_pool = true;
       }else
@@ -122,6 +154,7 @@ namespace currency
       txd_p.first->second.last_failed_height = 0;
       txd_p.first->second.last_failed_id = null_hash;
       txd_p.first->second.receive_time = time(nullptr);
+      m_fee_index.insert(&*txd_p.first);
       tvc.m_added_to_pool = true;
 
       if(txd_p.first->second.fee > 0)
@@ -192,9 +225,24 @@ namespace currency
     tx = it->second.tx;
     blob_size = it->second.blob_size;
     fee = it->second.fee;
+    erase_transaction(it);
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::erase_transaction(transactions_container::iterator it)
+  {
     remove_transaction_keyimages(it->second.tx);
+    m_fee_index.erase(&*it);
+    m_ready_cache.erase(it->first);
     m_transactions.erase(it);
-    return true;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::rebuild_fee_index()
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    m_fee_index.clear();
+    BOOST_FOREACH(transactions_container::value_type& txv, m_transactions)
+      m_fee_index.insert(&txv);
   }
   //---------------------------------------------------------------------------------
   void tx_memory_pool::on_idle()
@@ -213,8 +261,7 @@ namespace currency
          (tx_age > CURRENCY_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME && it->second.kept_by_block) )
       {
         LOG_PRINT_L0("Tx " << it->first << " removed from tx pool due to outdated, age: " << tx_age );
-        remove_transaction_keyimages(it->second.tx);
-        m_transactions.erase(it++);
+        erase_transaction(it++);
       }else
         ++it;
     }
@@ -299,6 +346,8 @@ namespace currency
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     m_transactions.clear();
     m_spent_key_images.clear();
+    m_fee_index.clear();
+    m_ready_cache.clear();
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::is_transaction_ready_to_go(tx_details& txd)
@@ -356,6 +405,14 @@ namespace currency
     return true;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::is_transaction_ready_to_go_cached(transactions_container::value_type& txv)
+  {
+    auto r = m_ready_cache.insert(std::make_pair(txv.first, false));
+    if (r.second)
+      r.first->second = is_transaction_ready_to_go(txv.second);
+    return r.first->second;
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::have_key_images(const std::unordered_set<crypto::key_image>& k_images, const transaction& tx)
   {
     for(size_t i = 0; i!= tx.vin.size(); i++)
@@ -425,13 +482,12 @@ namespace currency
     typedef transactions_container::value_type txv;
     CRITICAL_REGION_LOCAL(m_transactions_lock);
 
-    std::vector<txv *> txs(m_transactions.size());
-    std::transform(m_transactions.begin(), m_transactions.end(), txs.begin(), [](txv &a) -> txv * { return &a; });
-    std::sort(txs.begin(), txs.end(), [](txv *a, txv *b) -> bool {
-      uint64_t a_hi, a_lo = mul128(a->second.fee, b->second.blob_size, &a_hi);
-      uint64_t b_hi, b_lo = mul128(b->second.fee, a->second.blob_size, &b_hi);
-      return a_hi > b_hi || (a_hi == b_hi && a_lo > b_lo);
-    });
+    crypto::hash top_id = m_blockchain.get_top_block_id();
+    if (top_id != m_ready_cache_top_id)
+    {
+      m_ready_cache.clear();
+      m_ready_cache_top_id = top_id;
+    }
 
     size_t current_size = 0;
     uint64_t current_fee = 0;
@@ -448,11 +504,15 @@ namespace currency
 
     std::unordered_set<crypto::key_image> k_images;
 
-    for (size_t i = 0; i < txs.size(); i++) 
+    //transactions are taken in fee rate order until the block is full, the rest of the pool isn't looked at
+    std::vector<txv *> txs;
+    for (auto it = m_fee_index.begin(); it != m_fee_index.end() && tx_count <= 124; ++it)
     {
-      txv &tx(*txs[i]);
+      size_t i = txs.size();
+      txs.push_back(*it);
+      txv &tx(**it);
 
-      if (tx_count > 124 || !is_transaction_ready_to_go(tx.second) || have_key_images(k_images, tx.second.tx))
+      if (!is_transaction_ready_to_go_cached(tx) || have_key_images(k_images, tx.second.tx))
       {
         txs[i] = NULL;
         continue;
@@ -498,6 +558,7 @@ namespace currency
     if(!boost::filesystem::exists(state_file_path, ec))
       return true;
     bool res = tools::unserialize_obj_from_file(*this, state_file_path);
+    rebuild_fee_index();
     if (res)
     {
       // mem pool has just been successfully loaded from file
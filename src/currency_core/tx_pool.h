@@ -97,14 +97,29 @@ namespace currency
     };
 
   private:
-    bool remove_stuck_transactions();
-    bool is_transaction_ready_to_go(tx_details& txd);
     typedef std::unordered_map<crypto::hash, tx_details > transactions_container;
     typedef std::unordered_map<crypto::key_image, std::unordered_set<crypto::hash> > key_images_container;
+    //the best fee per byte first, ties are ordered by id
+    struct fee_rate_greater
+    {
+      bool operator()(const transactions_container::value_type* a, const transactions_container::value_type* b) const;
+    };
+    typedef std::set<transactions_container::value_type*, fee_rate_greater> fee_index_container;
+
+    bool remove_stuck_transactions();
+    bool is_transaction_ready_to_go(tx_details& txd);
+    bool is_transaction_ready_to_go_cached(transactions_container::value_type& txv);
+    void erase_transaction(transactions_container::iterator it);
+    void rebuild_fee_index();
 
     epee::critical_section m_transactions_lock;
     transactions_container m_transactions;
     key_images_container m_spent_key_images;
+    //kept in sync with m_transactions, so templates don't sort the whole pool
+    fee_index_container m_fee_index;
+    //is_transaction_ready_to_go() results, valid while the top block is m_ready_cache_top_id
+    std::unordered_map<crypto::hash, bool> m_ready_cache;
+    crypto::hash m_ready_cache_top_id;
     
     epee::math_helper::once_a_time_seconds<30> m_remove_stuck_tx_interval;
 
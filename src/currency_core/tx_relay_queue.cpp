@@ -0,0 +1,127 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "include_base_utils.h"
+#include "tx_relay_queue.h"
+
+namespace currency
+{
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::known_filter::add(const crypto::hash& h)
+  {
+    if (!m_ids.insert(h).second)
+      return;
+    m_order.push_back(h);
+    while (m_order.size() > m_limit)
+    {
+      m_ids.erase(m_order.front());
+      m_order.pop_front();
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  tx_relay_queue::tx_relay_queue(size_t known_filter_size, size_t max_batch_size, time_t request_timeout)
+    : m_known_filter_size(known_filter_size)
+    , m_max_batch_size(max_batch_size)
+    , m_request_timeout(request_timeout)
+  {}
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::add_connection(const boost::uuids::uuid& connection_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    if (m_peers.count(connection_id))
+      return;
+    m_peers[connection_id].known.set_limit(m_known_filter_size);
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::remove_connection(const boost::uuids::uuid& connection_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    m_peers.erase(connection_id);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool tx_relay_queue::has_connection(const boost::uuids::uuid& connection_id)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    return m_peers.count(connection_id) != 0;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::add_known(const boost::uuids::uuid& connection_id, const std::list<crypto::hash>& txs)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    auto it = m_peers.find(connection_id);
+    if (it == m_peers.end())
+      return;
+    for (const crypto::hash& h : txs)
+      it->second.known.add(h);
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::queue(const std::list<crypto::hash>& txs)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (auto& p : m_peers)
+    {
+      for (const crypto::hash& h : txs)
+      {
+        if (p.second.known.has(h))
+          continue;
+        p.second.known.add(h);
+        p.second.pending.push_back(h);
+      }
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::get_batches(batches_t& batches)
+  {
+    batches.clear();
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (auto& p : m_peers)
+    {
+      std::list<crypto::hash>& pending = p.second.pending;
+      if (pending.empty())
+        continue;
+      batches.push_back(batches_t::value_type(p.first, std::list<crypto::hash>()));
+      auto end = pending.begin();
+      for (size_t i = 0; i != m_max_batch_size && end != pending.end(); i++)
+        ++end;
+      batches.back().second.splice(batches.back().second.end(), pending, pending.begin(), end);
+    }
+    prune_requested();
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::filter_requested(std::list<crypto::hash>& txs)
+  {
+    time_t now = time(nullptr);
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (auto it = txs.begin(); it != txs.end();)
+    {
+      auto r = m_requested.insert(std::make_pair(*it, now));
+      if (!r.second && now - r.first->second < m_request_timeout)
+      {
+        it = txs.erase(it);
+        continue;
+      }
+      r.first->second = now;
+      ++it;
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::on_requested_received(const std::list<crypto::hash>& txs)
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (const crypto::hash& h : txs)
+      m_requested.erase(h);
+  }
+  //-----------------------------------------------------------------------------------------------
+  void tx_relay_queue::prune_requested()
+  {
+    time_t now = time(nullptr);
+    for (auto it = m_requested.begin(); it != m_requested.end();)
+    {
+      if (now - it->second >= m_request_timeout)
+        it = m_requested.erase(it);
+      else
+        ++it;
+    }
+  }
+}
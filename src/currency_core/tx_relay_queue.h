@@ -0,0 +1,76 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/functional/hash.hpp>
+#include <boost/thread.hpp>
+#include <boost/uuid/uuid.hpp>
+#include "crypto/hash.h"
+
+namespace currency
+{
+  /************************************************************************/
+  /* Trickle relay of transactions by inventories. Accepted transactions  */
+  /* are queued for every connection which isn't known to have them, and  */
+  /* announced by ids in batches; bodies go only to connections which     */
+  /* request them.                                                        */
+  /************************************************************************/
+  class tx_relay_queue
+  {
+  public:
+    typedef std::list<std::pair<boost::uuids::uuid, std::list<crypto::hash> > > batches_t;
+
+    tx_relay_queue(size_t known_filter_size, size_t max_batch_size, time_t request_timeout);
+
+    // connections which understand inventories, others get the bodies right away
+    void add_connection(const boost::uuids::uuid& connection_id);
+    void remove_connection(const boost::uuids::uuid& connection_id);
+    bool has_connection(const boost::uuids::uuid& connection_id);
+
+    // the connection has (or has been sent) these transactions, they are never announced to it
+    void add_known(const boost::uuids::uuid& connection_id, const std::list<crypto::hash>& txs);
+    // queues the announcement to every connection, which doesn't know the transactions
+    void queue(const std::list<crypto::hash>& txs);
+    // takes up to max_batch_size queued ids for each connection
+    void get_batches(batches_t& batches);
+
+    // leaves in txs only those not being requested already from any connection and marks them requested
+    void filter_requested(std::list<crypto::hash>& txs);
+    void on_requested_received(const std::list<crypto::hash>& txs);
+
+  private:
+    class known_filter
+    {
+    public:
+      known_filter() : m_limit(0) {}
+      void set_limit(size_t limit) { m_limit = limit; }
+      bool has(const crypto::hash& h) const { return m_ids.count(h) != 0; }
+      void add(const crypto::hash& h);
+    private:
+      size_t m_limit;
+      std::unordered_set<crypto::hash> m_ids;
+      std::deque<crypto::hash> m_order;           // oldest ids are forgotten first
+    };
+
+    struct peer
+    {
+      known_filter known;
+      std::list<crypto::hash> pending;
+    };
+
+    void prune_requested();
+
+    const size_t m_known_filter_size;
+    const size_t m_max_batch_size;
+    const time_t m_request_timeout;
+    boost::mutex m_lock;
+    std::unordered_map<boost::uuids::uuid, peer, boost::hash<boost::uuids::uuid> > m_peers;
+    std::unordered_map<crypto::hash, time_t> m_requested;
+  };
+}
@@ -14,6 +14,10 @@ namespace currency
 
 #define BC_COMMANDS_POOL_BASE 2000
 
+//CORE_SYNC_DATA::capabilities flags
+#define CURRENCY_PROTOCOL_CAPABILITY_COMPACT_BLOCKS   0x01  //NOTIFY_NEW_COMPACT_BLOCK and block transactions requests are understood
+#define CURRENCY_PROTOCOL_CAPABILITY_TX_INVENTORY     0x02  //new transactions are announced with NOTIFY_TX_INVENTORY and sent on NOTIFY_REQUEST_TXS
+
 
   /************************************************************************/
   /*                                                                      */
@@ -110,11 +114,13 @@ namespace currency
     uint64_t current_height;
     crypto::hash  top_id;
     uint64_t last_checkpoint_height;
+    uint64_t capabilities;             //CURRENCY_PROTOCOL_CAPABILITY_* flags, absent for older nodes
 
     BEGIN_KV_SERIALIZE_MAP()
       KV_SERIALIZE(current_height)
       KV_SERIALIZE_VAL_POD_AS_BLOB(top_id)
       KV_SERIALIZE(last_checkpoint_height)
+      KV_SERIALIZE(capabilities)
     END_KV_SERIALIZE_MAP()
   };
 
@@ -150,4 +156,91 @@ namespace currency
     };
   };
 
+  /************************************************************************/
+  /* New block without transactions bodies: the block blob carries the    */
+  /* header, miner tx and ids of transactions, which the receiver takes   */
+  /* from its pool or requests with NOTIFY_REQUEST_BLOCK_TXS              */
+  /************************************************************************/
+  struct NOTIFY_NEW_COMPACT_BLOCK
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 8;
+
+    struct request
+    {
+      blobdata block;
+      uint64_t current_blockchain_height;
+      uint32_t hop;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(block)
+        KV_SERIALIZE(current_blockchain_height)
+        KV_SERIALIZE(hop)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  struct NOTIFY_REQUEST_BLOCK_TXS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 9;
+
+    struct request
+    {
+      crypto::hash block_id;
+      std::list<crypto::hash> txs;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(block_id)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(txs)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  struct NOTIFY_RESPONSE_BLOCK_TXS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 10;
+
+    struct request
+    {
+      crypto::hash block_id;
+      std::list<blobdata> txs;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(block_id)
+        KV_SERIALIZE(txs)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  /************************************************************************/
+  /* Ids of new transactions; the ones the receiver lacks are requested   */
+  /* with NOTIFY_REQUEST_TXS and come in NOTIFY_NEW_TRANSACTIONS          */
+  /************************************************************************/
+  struct NOTIFY_TX_INVENTORY
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 11;
+
+    struct request
+    {
+      std::list<crypto::hash> txs;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(txs)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  struct NOTIFY_REQUEST_TXS
+  {
+    const static int ID = BC_COMMANDS_POOL_BASE + 12;
+
+    struct request
+    {
+      std::list<crypto::hash> txs;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(txs)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
 }
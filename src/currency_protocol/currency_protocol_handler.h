@@ -13,6 +13,9 @@
 #include "currency_core/connection_context.h"
 #include "currency_core/currency_stat_info.h"
 #include "currency_core/verification_context.h"
+#include "currency_core/block_download_scheduler.h"
+#include "currency_core/block_import_pipeline.h"
+#include "currency_core/tx_relay_queue.h"
 
 PUSH_WARNINGS
 DISABLE_VS_WARNINGS(4355)
@@ -30,6 +33,7 @@ namespace currency
     typedef CORE_SYNC_DATA payload_type;
 
     t_currency_protocol_handler(t_core& rcore, nodetool::i_p2p_endpoint<connection_context>* p_net_layout);
+    ~t_currency_protocol_handler();
 
     BEGIN_INVOKE_MAP2(currency_protocol_handler)
       HANDLE_NOTIFY_T2(NOTIFY_NEW_BLOCK, &currency_protocol_handler::handle_notify_new_block)
@@ -38,9 +42,15 @@ namespace currency
       HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_GET_OBJECTS, &currency_protocol_handler::handle_response_get_objects)
       HANDLE_NOTIFY_T2(NOTIFY_REQUEST_CHAIN, &currency_protocol_handler::handle_request_chain)
       HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_CHAIN_ENTRY, &currency_protocol_handler::handle_response_chain_entry)
+      HANDLE_NOTIFY_T2(NOTIFY_NEW_COMPACT_BLOCK, &currency_protocol_handler::handle_notify_new_compact_block)
+      HANDLE_NOTIFY_T2(NOTIFY_REQUEST_BLOCK_TXS, &currency_protocol_handler::handle_request_block_txs)
+      HANDLE_NOTIFY_T2(NOTIFY_RESPONSE_BLOCK_TXS, &currency_protocol_handler::handle_response_block_txs)
+      HANDLE_NOTIFY_T2(NOTIFY_TX_INVENTORY, &currency_protocol_handler::handle_notify_tx_inventory)
+      HANDLE_NOTIFY_T2(NOTIFY_REQUEST_TXS, &currency_protocol_handler::handle_request_txs)
     END_INVOKE_MAP2()
 
     bool on_idle();
+    bool on_tx_relay_idle();
     
     static void init_options(boost::program_options::options_description& desc);
 
@@ -53,6 +63,7 @@ namespace currency
     bool get_payload_sync_data(CORE_SYNC_DATA& hshd);
     bool get_stat_info(core_stat_info& stat_inf);
     bool on_callback(currency_connection_context& context);
+    void on_connection_close(currency_connection_context& context);
     t_core& get_core(){return m_core;}
     bool is_synchronized(){return m_synchronized;}
     void log_connections();
@@ -68,6 +79,11 @@ namespace currency
     int handle_response_get_objects(int command, NOTIFY_RESPONSE_GET_OBJECTS::request& arg, currency_connection_context& context);
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, currency_connection_context& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, currency_connection_context& context);
+    int handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, currency_connection_context& context);
+    int handle_request_block_txs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, currency_connection_context& context);
+    int handle_response_block_txs(int command, NOTIFY_RESPONSE_BLOCK_TXS::request& arg, currency_connection_context& context);
+    int handle_notify_tx_inventory(int command, NOTIFY_TX_INVENTORY::request& arg, currency_connection_context& context);
+    int handle_request_txs(int command, NOTIFY_REQUEST_TXS::request& arg, currency_connection_context& context);
 
 
     //----------------- i_bc_protocol_layout ---------------------------------------
@@ -75,10 +91,18 @@ namespace currency
     virtual bool relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg, currency_connection_context& exclude_context);
     //----------------------------------------------------------------------------------
     //bool get_payload_sync_data(HANDSHAKE_DATA::request& hshd, currency_connection_context& context);
-    bool request_missing_objects(currency_connection_context& context, bool check_having_blocks);
+    bool request_missing_objects(currency_connection_context& context);
+    void request_callback_for_waiting_connections();
+    void blocks_applier_worker();
+    bool apply_prevalidated_span(const prevalidated_span& ps);
     size_t get_synchronizing_connections_count();
     bool on_connection_synchronized();  
     bool check_stop_flag_and_exit(currency_connection_context& context);
+    int process_new_block(NOTIFY_NEW_BLOCK::request& arg, currency_connection_context& context);
+    //full block from compact one and pool transactions, or ids of the transactions the pool lacks
+    bool get_block_txs_from_pool(const block& b, std::list<blobdata>& txs, std::list<crypto::hash>& missed);
+    bool process_compact_block(const blobdata& block_blob, uint32_t hop, currency_connection_context& context);
+    void get_txs_ids(const std::list<blobdata>& txs, std::list<crypto::hash>& ids);
     t_core& m_core;
 
     nodetool::p2p_endpoint_stub<connection_context> m_p2p_stub;
@@ -90,7 +114,10 @@ namespace currency
     std::atomic<uint64_t> m_core_inital_height;
     std::atomic<uint64_t> m_core_current_height;
     std::atomic<bool> m_want_stop;
-
+    block_download_scheduler m_download_scheduler;
+    block_import_pipeline m_import_pipeline;
+    tx_relay_queue m_tx_relay;
+    boost::thread m_blocks_applier_thread;
 
 
     template<class t_parametr>
@@ -102,6 +129,15 @@ namespace currency
         return m_p2p->invoke_notify_to_peer(t_parametr::ID, blob, context);
       }
 
+      template<class t_parametr>
+      bool relay_post_notify(typename t_parametr::request& arg, const std::list<boost::uuids::uuid>& connections)
+      {
+        LOG_PRINT_L2("post relay " << typeid(t_parametr).name() << " to " << connections.size() << " connections -->");
+        std::string arg_buff;
+        epee::serialization::store_t_to_binary(arg, arg_buff);
+        return m_p2p->relay_notify(t_parametr::ID, arg_buff, connections);
+      }
+
       template<class t_parametr>
       bool relay_post_notify(typename t_parametr::request& arg, currency_connection_context& exlude_context)
       {
@@ -21,11 +21,27 @@ namespace currency
                                                                                                               m_max_height_seen(0),
                                                                                                               m_core_inital_height(0),
                                                                                                               m_core_current_height(0),
-                                                                                                              m_want_stop(false)
+                                                                                                              m_want_stop(false),
+                                                                                                              m_download_scheduler(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT, 
+                                                                                                                                   BLOCKS_SYNCHRONIZING_REQUESTS_PER_CONNECTION, 
+                                                                                                                                   BLOCKS_SYNCHRONIZING_MAX_BUFFERED_SPANS, 
+                                                                                                                                   BLOCKS_SYNCHRONIZING_REQUEST_TIMEOUT),
+                                                                                                              m_import_pipeline(m_download_scheduler, BLOCKS_SYNCHRONIZING_MAX_PREVALIDATED_SPANS),
+                                                                                                              m_tx_relay(CURRENCY_PROTOCOL_TX_KNOWN_FILTER_SIZE, 
+                                                                                                                         CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT, 
+                                                                                                                         CURRENCY_PROTOCOL_TX_REQUEST_TIMEOUT)
 
   {
     if(!m_p2p)
       m_p2p = &m_p2p_stub;
+  }
+  //-----------------------------------------------------------------------------------------------------------------------  
+  template<class t_core>
+  t_currency_protocol_handler<t_core>::~t_currency_protocol_handler()
+  {
+    m_import_pipeline.deinit();
+    if (m_blocks_applier_thread.joinable())
+      m_blocks_applier_thread.join();
   }
     //-----------------------------------------------------------------------------------
     template<class t_core>
@@ -39,6 +55,12 @@ namespace currency
   {
     if (command_line::has_arg(vm, arg_currency_protocol_explicit_set_online))
       m_been_synchronized = true;
+    //one core is left for the applier thread
+    size_t prevalidation_threads = std::max<size_t>(1, boost::thread::hardware_concurrency()) - 1;
+    m_import_pipeline.init(std::max<size_t>(1, prevalidation_threads), [this](const transaction& tx, const crypto::hash& tx_hash){
+      return m_core.prevalidate_tx(tx, tx_hash, true);
+    });
+    m_blocks_applier_thread = boost::thread(boost::bind(&t_currency_protocol_handler<t_core>::blocks_applier_worker, this));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------  
@@ -46,7 +68,9 @@ namespace currency
   bool t_currency_protocol_handler<t_core>::deinit()
   {
     m_want_stop = true;
-
+    m_import_pipeline.deinit();
+    if (m_blocks_applier_thread.joinable())
+      m_blocks_applier_thread.join();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------  
@@ -68,6 +92,10 @@ namespace currency
 
     if(context.m_state == currency_connection_context::state_synchronizing)
     {
+      //while blocks are downloaded the connection takes its part of them, core is busy with applying
+      if (m_download_scheduler.is_active())
+        return request_missing_objects(context);
+
       NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
 
       bool have_called = false;
@@ -92,6 +120,15 @@ namespace currency
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
+  void t_currency_protocol_handler<t_core>::on_connection_close(currency_connection_context& context)
+  {
+    m_tx_relay.remove_connection(context.m_connection_id);
+    //blocks requested from this connection go to others
+    if (m_download_scheduler.on_connection_closed(context.m_connection_id))
+      request_callback_for_waiting_connections();
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core> 
   bool t_currency_protocol_handler<t_core>::get_stat_info(core_stat_info& stat_inf)
   {
     bool have_called = false;
@@ -130,6 +167,9 @@ namespace currency
   bool t_currency_protocol_handler<t_core>::process_payload_sync_data(const CORE_SYNC_DATA& hshd, currency_connection_context& context, bool is_inital)
   {
     context.m_remote_blockchain_height = hshd.current_height;
+    context.m_remote_capabilities = hshd.capabilities;
+    if (hshd.capabilities & CURRENCY_PROTOCOL_CAPABILITY_TX_INVENTORY)
+      m_tx_relay.add_connection(context.m_connection_id);
     LOG_PRINT_MAGENTA("[PROCESS_PAYLOAD_SYNC_DATA][m_been_synchronized=" << m_been_synchronized << "]: hshd.current_height = " << hshd.current_height << "(" << hshd.top_id << ")", LOG_LEVEL_3);
     if (context.m_state == currency_connection_context::state_befor_handshake && !is_inital)
     {
@@ -236,6 +276,7 @@ namespace currency
   bool t_currency_protocol_handler<t_core>::get_payload_sync_data(CORE_SYNC_DATA& hshd)
   {
     bool have_called = false;
+    hshd.capabilities = CURRENCY_PROTOCOL_CAPABILITY_COMPACT_BLOCKS | CURRENCY_PROTOCOL_CAPABILITY_TX_INVENTORY;
     
     m_core.get_blockchain_storage().template call_if_no_batch_exclusive_operation<bool>(have_called, [&]()
     {
@@ -273,6 +314,12 @@ namespace currency
     if (!m_synchronized || context.m_state != currency_connection_context::state_normal || context.m_remote_blockchain_height <=1)
       return 1;
 
+    return process_new_block(arg, context);
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::process_new_block(NOTIFY_NEW_BLOCK::request& arg, currency_connection_context& context)
+  {
     for(auto tx_blob_it = arg.b.txs.begin(); tx_blob_it!=arg.b.txs.end();tx_blob_it++)
     {
       currency::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -315,6 +362,137 @@ namespace currency
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_currency_protocol_handler<t_core>::get_block_txs_from_pool(const block& b, std::list<blobdata>& txs, std::list<crypto::hash>& missed)
+  {
+    txs.clear();
+    missed.clear();
+    BOOST_FOREACH(const crypto::hash& tx_id, b.tx_hashes)
+    {
+      transaction tx = AUTO_VAL_INIT(tx);
+      if (m_core.get_tx_pool().get_transaction(tx_id, tx))
+        txs.push_back(tx_to_blob(tx));
+      else
+        missed.push_back(tx_id);
+    }
+    return missed.empty();
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_currency_protocol_handler<t_core>::process_compact_block(const blobdata& block_blob, uint32_t hop, currency_connection_context& context)
+  {
+    block b = AUTO_VAL_INIT(b);
+    if (!parse_and_validate_block_from_blob(block_blob, b))
+    {
+      LOG_PRINT_CCONTEXT_L0("Compact block verification failed: failed to parse block, dropping connection");
+      m_p2p->drop_connection(context);
+      return false;
+    }
+    crypto::hash id = get_block_hash(b);
+    if (m_core.have_block(id))
+      return true;
+
+    NOTIFY_NEW_BLOCK::request full_arg = AUTO_VAL_INIT(full_arg);
+    NOTIFY_REQUEST_BLOCK_TXS::request req = AUTO_VAL_INIT(req);
+    if (!get_block_txs_from_pool(b, full_arg.b.txs, req.txs))
+    {
+      //transactions bodies are requested once, the block waits for them in the connection context
+      context.m_pending_block = block_blob;
+      context.m_pending_block_hop = hop;
+      req.block_id = id;
+      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_BLOCK_TXS: " << req.txs.size() << " of " << b.tx_hashes.size() << " transactions of block " << id);
+      post_notify<NOTIFY_REQUEST_BLOCK_TXS>(req, context);
+      return true;
+    }
+
+    full_arg.b.block = block_blob;
+    full_arg.current_blockchain_height = context.m_remote_blockchain_height;
+    full_arg.hop = hop;
+    process_new_block(full_arg, context);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::handle_notify_new_compact_block(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, currency_connection_context& context)
+  {
+    LOG_PRINT_CCONTEXT_L2("NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")");
+    if (!m_synchronized || context.m_state != currency_connection_context::state_normal || context.m_remote_blockchain_height <= 1)
+      return 1;
+
+    process_compact_block(arg.block, arg.hop, context);
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::handle_request_block_txs(int command, NOTIFY_REQUEST_BLOCK_TXS::request& arg, currency_connection_context& context)
+  {
+    LOG_PRINT_CCONTEXT_L2("NOTIFY_REQUEST_BLOCK_TXS: " << arg.txs.size() << " transactions of block " << arg.block_id);
+    if (arg.txs.size() > CURRENCY_PROTOCOL_MAX_TXS_REQUEST_COUNT)
+    {
+      LOG_ERROR_CCONTEXT("requested objects count is too big (" << arg.txs.size() << ") expected not more then " << CURRENCY_PROTOCOL_MAX_TXS_REQUEST_COUNT << ", dropping connection");
+      m_p2p->drop_connection(context);
+      return 1;
+    }
+
+    //the block has been just added, so its transactions are in the blockchain, or in the pool if it went to an alt chain
+    NOTIFY_RESPONSE_BLOCK_TXS::request rsp = AUTO_VAL_INIT(rsp);
+    rsp.block_id = arg.block_id;
+    BOOST_FOREACH(const crypto::hash& tx_id, arg.txs)
+    {
+      blobdata tx_blob;
+      transaction tx = AUTO_VAL_INIT(tx);
+      if (m_core.get_blockchain_storage().get_transaction_blob(tx_id, tx_blob))
+        rsp.txs.push_back(tx_blob);
+      else if (m_core.get_tx_pool().get_transaction(tx_id, tx))
+        rsp.txs.push_back(tx_to_blob(tx));
+      else
+        LOG_PRINT_CCONTEXT_L1("NOTIFY_REQUEST_BLOCK_TXS: transaction " << tx_id << " not found");
+    }
+    LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_RESPONSE_BLOCK_TXS: " << rsp.txs.size() << " transactions");
+    post_notify<NOTIFY_RESPONSE_BLOCK_TXS>(rsp, context);
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::handle_response_block_txs(int command, NOTIFY_RESPONSE_BLOCK_TXS::request& arg, currency_connection_context& context)
+  {
+    LOG_PRINT_CCONTEXT_L2("NOTIFY_RESPONSE_BLOCK_TXS: " << arg.txs.size() << " transactions of block " << arg.block_id);
+    block b = AUTO_VAL_INIT(b);
+    if (context.m_pending_block.empty() || !parse_and_validate_block_from_blob(context.m_pending_block, b) || get_block_hash(b) != arg.block_id)
+    {
+      LOG_PRINT_CCONTEXT_L1("NOTIFY_RESPONSE_BLOCK_TXS for not requested block " << arg.block_id << ", ignored");
+      return 1;
+    }
+    blobdata block_blob;
+    block_blob.swap(context.m_pending_block);
+    if (!m_synchronized || context.m_state != currency_connection_context::state_normal)
+      return 1;
+
+    NOTIFY_NEW_BLOCK::request full_arg = AUTO_VAL_INIT(full_arg);
+    full_arg.b.block = block_blob;
+    full_arg.b.txs.swap(arg.txs);
+    full_arg.current_blockchain_height = context.m_remote_blockchain_height;
+    full_arg.hop = context.m_pending_block_hop;
+
+    //transactions the sender didn't provide should be in the pool, otherwise the block fails as usual
+    std::unordered_set<crypto::hash> provided;
+    BOOST_FOREACH(const blobdata& tx_blob, full_arg.b.txs)
+    {
+      transaction tx = AUTO_VAL_INIT(tx);
+      crypto::hash tx_id = null_hash, tx_prefix_hash = null_hash;
+      if (parse_and_validate_tx_from_blob(tx_blob, tx, tx_id, tx_prefix_hash))
+        provided.insert(tx_id);
+    }
+    BOOST_FOREACH(const crypto::hash& tx_id, b.tx_hashes)
+    {
+      transaction tx = AUTO_VAL_INIT(tx);
+      if (!provided.count(tx_id) && m_core.get_tx_pool().get_transaction(tx_id, tx))
+        full_arg.b.txs.push_back(tx_to_blob(tx));
+    }
+    process_new_block(full_arg, context);
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
   int t_currency_protocol_handler<t_core>::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, currency_connection_context& context)
   {
@@ -324,6 +502,12 @@ namespace currency
       return 1;
 
 
+    //the sender has them, so they are never announced back to it
+    std::list<crypto::hash> ids;
+    get_txs_ids(arg.txs, ids);
+    m_tx_relay.add_known(context.m_connection_id, ids);
+    m_tx_relay.on_requested_received(ids);
+
     for(auto tx_blob_it = arg.txs.begin(); tx_blob_it!=arg.txs.end();)
     {
       currency::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -343,13 +527,99 @@ namespace currency
 
     if(arg.txs.size())
     {
-      //TODO: add announce usage here
       relay_transactions(arg, context);
     }
 
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_currency_protocol_handler<t_core>::get_txs_ids(const std::list<blobdata>& txs, std::list<crypto::hash>& ids)
+  {
+    ids.clear();
+    BOOST_FOREACH(const blobdata& tx_blob, txs)
+    {
+      transaction tx = AUTO_VAL_INIT(tx);
+      crypto::hash tx_id = null_hash, tx_prefix_hash = null_hash;
+      if (parse_and_validate_tx_from_blob(tx_blob, tx, tx_id, tx_prefix_hash))
+        ids.push_back(tx_id);
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::handle_notify_tx_inventory(int command, NOTIFY_TX_INVENTORY::request& arg, currency_connection_context& context)
+  {
+    LOG_PRINT_CCONTEXT_L2("NOTIFY_TX_INVENTORY: " << arg.txs.size() << " transactions");
+    if (arg.txs.size() > CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT)
+    {
+      LOG_ERROR_CCONTEXT("sent too many transactions ids (" << arg.txs.size() << ") expected not more then " << CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT << ", dropping connection");
+      m_p2p->drop_connection(context);
+      return 1;
+    }
+    m_tx_relay.add_known(context.m_connection_id, arg.txs);
+
+    if (!m_synchronized || context.m_state != currency_connection_context::state_normal || context.m_remote_blockchain_height <= 1)
+      return 1;
+
+    NOTIFY_REQUEST_TXS::request req = AUTO_VAL_INIT(req);
+    BOOST_FOREACH(const crypto::hash& tx_id, arg.txs)
+    {
+      if (!m_core.get_tx_pool().have_tx(tx_id) && !m_core.get_blockchain_storage().have_tx(tx_id))
+        req.txs.push_back(tx_id);
+    }
+    //transactions announced by several connections are requested from the first one
+    m_tx_relay.filter_requested(req.txs);
+    if (req.txs.size())
+    {
+      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_TXS: " << req.txs.size() << " transactions");
+      post_notify<NOTIFY_REQUEST_TXS>(req, context);
+    }
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  int t_currency_protocol_handler<t_core>::handle_request_txs(int command, NOTIFY_REQUEST_TXS::request& arg, currency_connection_context& context)
+  {
+    LOG_PRINT_CCONTEXT_L2("NOTIFY_REQUEST_TXS: " << arg.txs.size() << " transactions");
+    if (arg.txs.size() > CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT)
+    {
+      LOG_ERROR_CCONTEXT("requested too many transactions (" << arg.txs.size() << ") expected not more then " << CURRENCY_PROTOCOL_TX_INVENTORY_MAX_COUNT << ", dropping connection");
+      m_p2p->drop_connection(context);
+      return 1;
+    }
+
+    //only pool transactions are given, the ones already in blocks come with them
+    NOTIFY_NEW_TRANSACTIONS::request rsp = AUTO_VAL_INIT(rsp);
+    BOOST_FOREACH(const crypto::hash& tx_id, arg.txs)
+    {
+      transaction tx = AUTO_VAL_INIT(tx);
+      if (m_core.get_tx_pool().get_transaction(tx_id, tx))
+        rsp.txs.push_back(tx_to_blob(tx));
+    }
+    m_tx_relay.add_known(context.m_connection_id, arg.txs);
+    if (rsp.txs.size())
+    {
+      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_NEW_TRANSACTIONS: " << rsp.txs.size() << " requested transactions");
+      post_notify<NOTIFY_NEW_TRANSACTIONS>(rsp, context);
+    }
+    return 1;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_currency_protocol_handler<t_core>::on_tx_relay_idle()
+  {
+    tx_relay_queue::batches_t batches;
+    m_tx_relay.get_batches(batches);
+    BOOST_FOREACH(auto& batch, batches)
+    {
+      NOTIFY_TX_INVENTORY::request req = AUTO_VAL_INIT(req);
+      req.txs.swap(batch.second);
+      std::list<boost::uuids::uuid> connections(1, batch.first);
+      relay_post_notify<NOTIFY_TX_INVENTORY>(req, connections);
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
   int t_currency_protocol_handler<t_core>::handle_request_get_objects(int command, NOTIFY_REQUEST_GET_OBJECTS::request& arg, currency_connection_context& context)
   {
@@ -401,176 +671,151 @@ namespace currency
 
     context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-    PROF_L2_DO(uint64_t syncing_conn_count_sum = get_synchronizing_connections_count(); uint64_t syncing_conn_count_count = 1);
+    //blocks are parsed and checked by import pipeline workers and applied in height order by blocks applier thread, while the connection downloads next ones
+    size_t blocks_count = arg.blocks.size();
+    if (!m_download_scheduler.on_span_received(context.m_connection_id, arg.blocks))
+    {
+      LOG_ERROR_CCONTEXT("sent wrong NOTIFY_RESPONSE_GET_OBJECTS: " << blocks_count << " blocks (" << arg.missed_ids.size() << " missed) don't match any of requested ones, dropping connection");
+      m_p2p->drop_connection(context);
+      return 1;
+    }
 
-    bool have_called = false;
-    int res = m_core.get_blockchain_storage().template call_if_no_batch_exclusive_operation<int>(have_called, [&]()
+    request_missing_objects(context);
+    return 1;
+  }
+#undef CHECK_STOP_FLAG__DROP_AND_RETURN_IF_SET
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_currency_protocol_handler<t_core>::blocks_applier_worker()
+  {
+    prevalidated_span ps = AUTO_VAL_INIT(ps);
+    while (m_import_pipeline.get_next_span(ps))
     {
-      PROF_L1_START(block_complete_entries_prevalidation_time);
-      size_t count = 0;
-      for (const block_complete_entry& block_entry : arg.blocks)
+      TIME_MEASURE_START(apply_time);
+      if (m_download_scheduler.is_outdated(ps.source))
       {
-        CHECK_STOP_FLAG_EXIT_IF_SET(1, "Blocks processing interrupted, connection dropped");
+        //taken before the download was restarted, its blocks are requested again
+        m_download_scheduler.on_span_applied(ps.source);
+      }
+      else if (ps.valid && apply_prevalidated_span(ps))
+      {
+        m_download_scheduler.on_span_applied(ps.source);
+      }
+      else
+      {
+        //everything downloaded after the failed span is built on it, start over with the chain from the core
+        m_download_scheduler.reset();
+        epee::net_utils::connection_context_base source_context(ps.source.connection_id, ps.source.remote_ip, 0, false);
+        m_p2p->drop_connection(source_context);
+        m_p2p->add_ip_fail(ps.source.remote_ip);
+      }
+      TIME_MEASURE_FINISH(apply_time);
+      m_import_pipeline.on_span_applied(ps, apply_time);
+      request_callback_for_waiting_connections();
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  bool t_currency_protocol_handler<t_core>::apply_prevalidated_span(const prevalidated_span& ps)
+  {
+    std::string remote_ip_str = string_tools::get_ip_string_from_int32(ps.source.remote_ip);
+    PROF_L1_START(blocks_handle_time);
+    {
+      m_core.pause_mine();
+      m_core.get_blockchain_storage().start_batch_exclusive_operation();
+      bool success = false;
+      misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler([&, this](){
+        m_core.get_blockchain_storage().finish_batch_exclusive_operation(success);
+        m_core.resume_mine();
+      });
 
-        ++count;
-        block b;
-        if (!parse_and_validate_block_from_blob(block_entry.block, b))
+      BOOST_FOREACH(const prevalidated_block& pb, ps.blocks)
+      {
+        if (m_p2p->is_stop_signal_sent() || m_want_stop)
         {
-          LOG_ERROR_CCONTEXT("sent wrong block: failed to parse and validate block: \r\n"
-            << string_tools::buff_to_hex_nodelimer(block_entry.block) << "\r\n dropping connection");
-          m_p2p->drop_connection(context);
-          m_p2p->add_ip_fail(context.m_remote_ip);
-          return 1;
+          LOG_PRINT_YELLOW("Stop flag detected within blocks applying, blocks processing interrupted", LOG_LEVEL_0);
+          //commit transaction
+          success = true;
+          return true;
         }
-        //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-        if (count == 2)
+        //process transactions, they are parsed and checked already
+        PROF_L1_START(transactions_process_time);
+        for (size_t i = 0; i != pb.txs.size(); i++)
         {
-          if (m_core.have_block(get_block_hash(b)))
+          tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+          m_core.add_prevalidated_tx(pb.txs[i], pb.tx_hashes[i], tvc, true);
+          if (tvc.m_verifivation_failed)
           {
-            LOG_PRINT_MAGENTA("[RESPONSE_GET_OBJECTS]: m_state set state_idle", LOG_LEVEL_3);
-            context.m_state = currency_connection_context::state_idle;
-            context.m_needed_objects.clear();
-            context.m_requested_objects.clear();
-            LOG_PRINT_CCONTEXT_L1("Connection set to idle state.");
-            return 1;
+            LOG_ERROR("[" << remote_ip_str << "] transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+              << string_tools::pod_to_hex(pb.tx_hashes[i]) << ", dropping connection");
+            return false;
           }
         }
+        PROF_L1_FINISH(transactions_process_time);
 
-        auto req_it = context.m_requested_objects.find(get_block_hash(b));
-        if (req_it == context.m_requested_objects.end())
+        //process block
+        PROF_L1_START(block_process_time);
+        block_verification_context bvc = boost::value_initialized<block_verification_context>();
+
+        m_core.handle_incoming_block(pb.bl, bvc, false);
+
+        if (bvc.m_verifivation_failed)
         {
-          LOG_ERROR_CCONTEXT("sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << string_tools::pod_to_hex(get_blob_hash(block_entry.block))
-            << " wasn't requested, dropping connection");
-          m_p2p->drop_connection(context);
-          return 1;
+          LOG_PRINT_L0("[" << remote_ip_str << "] Block verification failed, dropping connection");
+          return false;
         }
-        if (b.tx_hashes.size() != block_entry.txs.size())
+        if (bvc.m_marked_as_orphaned)
         {
-          LOG_ERROR_CCONTEXT("sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << string_tools::pod_to_hex(get_blob_hash(block_entry.block))
-            << ", tx_hashes.size()=" << b.tx_hashes.size() << " mismatch with block_complete_entry.m_txs.size()=" << block_entry.txs.size() << ", dropping connection");
-          m_p2p->drop_connection(context);
-          return 1;
+          LOG_PRINT_L0("[" << remote_ip_str << "] Block received at sync phase was marked as orphaned, dropping connection");
+          return false;
         }
-
-        context.m_requested_objects.erase(req_it);
-      }
-      PROF_L1_FINISH(block_complete_entries_prevalidation_time);
-
-      PROF_L2_DO(syncing_conn_count_sum += get_synchronizing_connections_count(); ++syncing_conn_count_count);
-
-      if (context.m_requested_objects.size())
-      {
-        LOG_PRINT_CCONTEXT_RED("returned not all requested objects (context.m_requested_objects.size()="
-          << context.m_requested_objects.size() << "), dropping connection", LOG_LEVEL_0);
-        m_p2p->drop_connection(context);
-        return 1;
+        m_core_current_height = bvc.height;
+        PROF_L1_FINISH(block_process_time);
+        PROF_L1_DO(LOG_PRINT_L2("[" << remote_ip_str << "] Block process time: " << print_mcsec_as_ms(block_process_time + transactions_process_time) << "(" << print_mcsec_as_ms(transactions_process_time) << "/" << print_mcsec_as_ms(block_process_time) << ") ms"));
       }
+      success = true;
+    }
+    PROF_L1_FINISH(blocks_handle_time);
 
-      PROF_L1_START(blocks_handle_time);
+    size_t queued = 0, requested = 0, received = 0;
+    m_download_scheduler.get_stats(queued, requested, received);
+    block_import_pipeline::stats st = AUTO_VAL_INIT(st);
+    m_import_pipeline.get_stats(st);
+    uint64_t current_height = m_core_current_height + 1;
+    uint64_t max_height_seen = std::max<uint64_t>(m_max_height_seen, current_height);
+    LOG_PRINT_YELLOW("[" << remote_ip_str << "] >>>>>>>>> sync progress: " << ps.blocks.size() << " blocks added"
+      "(" << print_mcsec_as_ms(blocks_handle_time) << "), now have "
+      << current_height << " of " << max_height_seen
+      << " ( " << std::fixed << std::setprecision(2) << current_height * 100.0 / max_height_seen << "% ) and "
+      << max_height_seen - current_height << " blocks left, spans downloaded/requested/queued: " << received << "/" << requested << "/" << queued
+      , LOG_LEVEL_0);
+    LOG_PRINT_L1("Blocks import: prevalidating/ready spans: " << st.spans_in_progress << "/" << st.spans_ready
+      << ", prevalidation busy/wait: " << print_mcsec_as_ms(st.prevalidation.busy_time) << "/" << print_mcsec_as_ms(st.prevalidation.wait_time)
+      << " ms, apply busy/wait: " << print_mcsec_as_ms(st.apply.busy_time) << "/" << print_mcsec_as_ms(st.apply.wait_time) << " ms, "
+      << st.apply.blocks << " blocks applied");
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------
+  template<class t_core>
+  void t_currency_protocol_handler<t_core>::request_callback_for_waiting_connections()
+  {
+    m_p2p->for_each_connection([&](currency_connection_context& context, nodetool::peerid_type peer_id)->bool{
+      if (context.m_state == currency_connection_context::state_synchronizing && !context.m_callback_request_count
+        && !m_download_scheduler.get_requests_count(context.m_connection_id))
       {
-        m_core.pause_mine();
-        m_core.get_blockchain_storage().start_batch_exclusive_operation();
-        bool success = false;
-        misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler([&, this](){
-          boost::bind(&t_core::resume_mine, &m_core);
-          m_core.get_blockchain_storage().finish_batch_exclusive_operation(success);
-        });
-
-        BOOST_FOREACH(const block_complete_entry& block_entry, arg.blocks)
-        {
-          CHECK_STOP_FLAG_EXIT_IF_SET(1, "Blocks processing interrupted, connection dropped");
-          //process transactions
-          PROF_L1_START(transactions_process_time);
-          BOOST_FOREACH(auto& tx_blob, block_entry.txs)
-          {
-            //CHECK_STOP_FLAG_EXIT_IF_SET(1, "Blocks processing interrupted, connection dropped");
-            if (check_stop_flag_and_exit(context)) 
-            {             
-              LOG_PRINT_YELLOW("Stop flag detected within NOTIFY_RESPONSE_GET_OBJECTS. ", LOG_LEVEL_0);
-              //commit transaction
-              success = true;
-              return 1; 
-            }
-            tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-            m_core.handle_incoming_tx(tx_blob, tvc, true);
-            if (tvc.m_verifivation_failed)
-            {
-              LOG_ERROR_CCONTEXT("transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-                << string_tools::pod_to_hex(get_blob_hash(tx_blob)) << ", dropping connection");
-              m_p2p->drop_connection(context);
-              return 1;
-            }
-          }
-          PROF_L1_FINISH(transactions_process_time);
-
-          //process block
-          PROF_L1_START(block_process_time);
-          block_verification_context bvc = boost::value_initialized<block_verification_context>();
-
-          m_core.handle_incoming_block(block_entry.block, bvc, false);
-
-          if (bvc.m_verifivation_failed)
-          {
-            LOG_PRINT_CCONTEXT_L0("Block verification failed, dropping connection");
-            m_p2p->drop_connection(context);
-            m_p2p->add_ip_fail(context.m_remote_ip);
-            return 1;
-          }
-          if (bvc.m_marked_as_orphaned)
-          {
-            LOG_PRINT_CCONTEXT_L0("Block received at sync phase was marked as orphaned, dropping connection");
-            m_p2p->drop_connection(context);
-            m_p2p->add_ip_fail(context.m_remote_ip);
-            return 1;
-          }
-          m_core_current_height = bvc.height;
-          PROF_L1_FINISH(block_process_time);
-          PROF_L1_DO(LOG_PRINT_CCONTEXT_L2("Block process time: " << print_mcsec_as_ms(block_process_time + transactions_process_time) << "(" << print_mcsec_as_ms(transactions_process_time) << "/" << print_mcsec_as_ms(block_process_time) << ") ms"));
-
-          PROF_L2_DO(syncing_conn_count_sum += get_synchronizing_connections_count(); ++syncing_conn_count_count);
-        }
-        success = true;
+        ++context.m_callback_request_count;
+        m_p2p->request_callback(context);
       }
-      PROF_L1_FINISH(blocks_handle_time);
-
-      uint64_t current_height = m_core.get_current_blockchain_height();
-      LOG_PRINT_CCONTEXT_YELLOW(">>>>>>>>> sync progress: " << arg.blocks.size() << " blocks added"
-        "(" << print_mcsec_as_ms(blocks_handle_time) << "+" << print_mcsec_as_ms(block_complete_entries_prevalidation_time) << "), now have "
-        << current_height << " of " << context.m_remote_blockchain_height
-        << " ( " << std::fixed << std::setprecision(2) << current_height * 100.0 / context.m_remote_blockchain_height << "% ) and "
-        << context.m_remote_blockchain_height - current_height << " blocks left"
-        , LOG_LEVEL_0);
-
-        PROF_L2_DO(syncing_conn_count_sum += get_synchronizing_connections_count(); ++syncing_conn_count_count);
-     
-
-
-#if PROFILING_LEVEL >= 2
-      double syncing_conn_count_av = syncing_conn_count_sum / static_cast<double>(syncing_conn_count_count);
-      size_t blocks_count = arg.blocks.size();
-      LOG_PRINT_CCONTEXT_YELLOW("NOTIFY_RESPONSE_GET_OBJECTS: " << blocks_count << " blocks were prevalidated in " << block_complete_entries_prevalidation_time / 1000
-        << " ms (" << std::fixed << std::setprecision(2) << block_complete_entries_prevalidation_time / 1000.0f / blocks_count << " ms per block av) and handled in " << blocks_handle_time / 1000
-        << " ms (" << std::fixed << std::setprecision(2) << blocks_handle_time / 1000.0f / blocks_count << " ms per block av)"
-        << " syncing conns av: " << std::fixed << std::setprecision(2) << syncing_conn_count_av, LOG_LEVEL_1);
-#endif
-
-      request_missing_objects(context, true);
-      return 1;
+      return true;
     });
-
-    if (!have_called)
-    {
-      context.m_state = currency_connection_context::state_idle;
-      LOG_PRINT_CCONTEXT_MAGENTA("[HANDLE_RESPONSE_GET_OBJECTS]: Core blocked response, m_state set state_idle", LOG_LEVEL_0);
-    }
-      
-    return res;
   }
-#undef CHECK_STOP_FLAG__DROP_AND_RETURN_IF_SET
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
   bool t_currency_protocol_handler<t_core>::on_idle()
   {
+    //requests lost by slow connections are given to others
+    if (m_download_scheduler.check_timeouts())
+      request_callback_for_waiting_connections();
 
     size_t count_synced = 0;
     size_t count_total = 0;
@@ -642,28 +887,38 @@ namespace currency
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
-  bool t_currency_protocol_handler<t_core>::request_missing_objects(currency_connection_context& context, bool check_having_blocks)
+  bool t_currency_protocol_handler<t_core>::request_missing_objects(currency_connection_context& context)
   {
-    if(context.m_needed_objects.size())
+    std::list<std::list<crypto::hash> > requests;
+    size_t requests_in_flight = m_download_scheduler.get_spans_to_request(context.m_connection_id, context.m_remote_ip, context.m_remote_blockchain_height, requests);
+    for (auto& ids : requests)
     {
       //we know objects that we need, request this objects
       NOTIFY_REQUEST_GET_OBJECTS::request req;
-      size_t count = 0;
-      auto it = context.m_needed_objects.begin();
+      req.blocks.swap(ids);
+      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size());
+      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(req, context);
+    }
+    if (requests_in_flight)
+      return true;
 
-      while(it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+    if (m_download_scheduler.is_active())
+    {
+      crypto::hash last_id = null_hash;
+      if (m_download_scheduler.start_chain_request(context.m_remote_blockchain_height, last_id))
       {
-        if( !(check_having_blocks && m_core.have_block(*it)))
-        {
-          req.blocks.push_back(*it);
-          ++count;
-          context.m_requested_objects.insert(*it);
-        }
-        context.m_needed_objects.erase(it++);
+        //core is busy with applying blocks, so the chain is continued from the last scheduled block
+        NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+        r.block_ids.push_back(last_id);
+        r.block_ids.push_back(get_genesis_id());
+        LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size());
+        post_notify<NOTIFY_REQUEST_CHAIN>(r, context);
       }
-      LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size());
-      post_notify<NOTIFY_REQUEST_GET_OBJECTS>(req, context);    
-    }else if(context.m_last_response_height < context.m_remote_blockchain_height-1)
+      //otherwise the connection waits for callback, which is requested when blocks are applied or returned to the queue
+      return true;
+    }
+
+    if(context.m_last_response_height < context.m_remote_blockchain_height-1)
     {//we have to fetch more objects ids, request blockchain entry
      
       NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
@@ -684,13 +939,9 @@ namespace currency
       }
     }else
     { 
-      CHECK_AND_ASSERT_MES(context.m_last_response_height == context.m_remote_blockchain_height-1 
-                           && !context.m_needed_objects.size() 
-                           && !context.m_requested_objects.size(), false, "request_missing_blocks final condition failed!" 
+      CHECK_AND_ASSERT_MES(context.m_last_response_height == context.m_remote_blockchain_height-1, false, "request_missing_blocks final condition failed!" 
                            << "\r\nm_last_response_height=" << context.m_last_response_height
                            << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-                           << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
-                           << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size()
                            << "\r\non connection [" << net_utils::print_connection_context_short(context)<< "]");
       
       LOG_PRINT_CCONTEXT_MAGENTA("[REQUEST_MISSING_OBJECTS] m_state set state_normal", LOG_LEVEL_0);
@@ -745,8 +996,26 @@ namespace currency
       return 1;
     }
 
+    context.m_remote_blockchain_height = arg.total_height;
+    context.m_last_response_height = arg.start_height + arg.m_block_ids.size() - 1;
+    if (context.m_last_response_height > context.m_remote_blockchain_height)
+    {
+      LOG_ERROR_CCONTEXT("sent wrong NOTIFY_RESPONSE_CHAIN_ENTRY, with \r\nm_total_height=" << arg.total_height
+        << "\r\nm_start_height=" << arg.start_height
+        << "\r\nm_block_ids.size()=" << arg.m_block_ids.size());
+      m_p2p->drop_connection(context);
+      return 1;
+    }
+
+    //continuation of the chain being downloaded doesn't need the core, which may be busy with applying blocks
+    if (m_download_scheduler.continue_chain(arg.m_block_ids))
+    {
+      request_missing_objects(context);
+      return 1;
+    }
+
     bool have_called = false;
-    m_core.get_blockchain_storage().template call_if_no_batch_exclusive_operation<bool>(have_called, [&]()
+    bool r = m_core.get_blockchain_storage().template call_if_no_batch_exclusive_operation<bool>(have_called, [&]()
     {
       if (!m_core.have_block(arg.m_block_ids.front()))
       {
@@ -754,45 +1023,87 @@ namespace currency
           << string_tools::pod_to_hex(arg.m_block_ids.front()) << " , dropping connection");
         m_p2p->drop_connection(context);
         m_p2p->add_ip_fail(context.m_remote_ip);
-        return 1;
-      }
-
-      context.m_remote_blockchain_height = arg.total_height;
-      context.m_last_response_height = arg.start_height + arg.m_block_ids.size() - 1;
-      if (context.m_last_response_height > context.m_remote_blockchain_height)
-      {
-        LOG_ERROR_CCONTEXT("sent wrong NOTIFY_RESPONSE_CHAIN_ENTRY, with \r\nm_total_height=" << arg.total_height
-          << "\r\nm_start_height=" << arg.start_height
-          << "\r\nm_block_ids.size()=" << arg.m_block_ids.size());
-        m_p2p->drop_connection(context);
+        return false;
       }
 
+      std::list<crypto::hash> needed_objects;
+      uint64_t needed_start_height = arg.start_height;
       for(auto& bl_id: arg.m_block_ids)
       {
         if (check_stop_flag_and_exit(context))
-          return 1;
+          return false;
         if (!m_core.have_block(bl_id))
-          context.m_needed_objects.push_back(bl_id);
+          needed_objects.push_back(bl_id);
+        else if (needed_objects.empty())
+          ++needed_start_height;
       }
-
-      request_missing_objects(context, false);
-      return 1;
+      if (needed_objects.size())
+        m_download_scheduler.add_chain(needed_start_height, needed_objects);
+      return true;
     });
 
+    if (!have_called && !m_download_scheduler.is_active())
+    {
+      LOG_PRINT_CCONTEXT_MAGENTA("[HANDLE_RESPONSE_CHAIN_ENTRY]: Core blocked response, m_state set state_idle", LOG_LEVEL_0);
+      context.m_state = currency_connection_context::state_idle;
+      return 1;
+    }
+    if (have_called && !r)
+      return 1;
 
-
+    request_missing_objects(context);
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
   bool t_currency_protocol_handler<t_core>::relay_block(NOTIFY_NEW_BLOCK::request& arg, currency_connection_context& exclude_context)
   {
-    return relay_post_notify<NOTIFY_NEW_BLOCK>(arg, exclude_context);
+    //peers which understand compact blocks get the block without transactions bodies, they have them in the pool mostly
+    std::list<boost::uuids::uuid> compact_connections, full_connections;
+    m_p2p->for_each_connection([&](currency_connection_context& cntxt, nodetool::peerid_type peer_id)
+    {
+      if (peer_id && cntxt.m_connection_id != exclude_context.m_connection_id)
+      {
+        if (cntxt.m_remote_capabilities & CURRENCY_PROTOCOL_CAPABILITY_COMPACT_BLOCKS)
+          compact_connections.push_back(cntxt.m_connection_id);
+        else
+          full_connections.push_back(cntxt.m_connection_id);
+      }
+      return true;
+    });
+
+    if (compact_connections.size())
+    {
+      NOTIFY_NEW_COMPACT_BLOCK::request compact_arg = AUTO_VAL_INIT(compact_arg);
+      compact_arg.block = arg.b.block;
+      compact_arg.current_blockchain_height = arg.current_blockchain_height;
+      compact_arg.hop = arg.hop;
+      relay_post_notify<NOTIFY_NEW_COMPACT_BLOCK>(compact_arg, compact_connections);
+    }
+    if (full_connections.size())
+      relay_post_notify<NOTIFY_NEW_BLOCK>(arg, full_connections);
+    return true;
   }
   //------------------------------------------------------------------------------------------------------------------------
   template<class t_core> 
   bool t_currency_protocol_handler<t_core>::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg, currency_connection_context& exclude_context)
   {
-    return relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(arg, exclude_context);
+    //connections which understand inventories get batched announcements of ids from on_tx_relay_idle(), others get the bodies now
+    std::list<boost::uuids::uuid> full_connections;
+    m_p2p->for_each_connection([&](currency_connection_context& cntxt, nodetool::peerid_type peer_id)
+    {
+      if (peer_id && cntxt.m_connection_id != exclude_context.m_connection_id && !m_tx_relay.has_connection(cntxt.m_connection_id))
+        full_connections.push_back(cntxt.m_connection_id);
+      return true;
+    });
+
+    std::list<crypto::hash> ids;
+    get_txs_ids(arg.txs, ids);
+    m_tx_relay.add_known(exclude_context.m_connection_id, ids);
+    m_tx_relay.queue(ids);
+
+    if (full_connections.size())
+      relay_post_notify<NOTIFY_NEW_TRANSACTIONS>(arg, full_connections);
+    return true;
   }
 }
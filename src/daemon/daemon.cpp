@@ -213,12 +213,13 @@ int main(int argc, char* argv[])
   rpc_server.timed_wait_server_stop(5000);
 
   //deinitialize components
+  //currency_protocol goes first, it stops blocks applier thread working with the core
+  LOG_PRINT_L0("Deinitializing currency_protocol...");
+  cprotocol.deinit();
   LOG_PRINT_L0("Deinitializing core...");
   ccore.deinit();
   LOG_PRINT_L0("Deinitializing rpc server ...");
   rpc_server.deinit();
-  LOG_PRINT_L0("Deinitializing currency_protocol...");
-  cprotocol.deinit();
   LOG_PRINT_L0("Deinitializing p2p...");
   p2psrv.deinit();
 
@@ -288,6 +288,12 @@ void daemon_backend::main_worker(const po::variables_map& vm)
 
   //deinitialize components
 
+  LOG_PRINT_L0("Deinitializing currency_protocol...");
+  dsi.text_state = "Deinitializing currency_protocol";
+  m_pview->update_daemon_status(dsi);
+  m_cprotocol.deinit();
+
+
   LOG_PRINT_L0("Deinitializing core...");
   dsi.text_state = "Deinitializing core";
   m_pview->update_daemon_status(dsi);
@@ -300,12 +306,6 @@ void daemon_backend::main_worker(const po::variables_map& vm)
   m_rpc_server.deinit();
 
 
-  LOG_PRINT_L0("Deinitializing currency_protocol...");
-  dsi.text_state = "Deinitializing currency_protocol";
-  m_pview->update_daemon_status(dsi);
-  m_cprotocol.deinit();
-
-
   LOG_PRINT_L0("Deinitializing p2p...");
   dsi.text_state = "Deinitializing p2p";
   m_pview->update_daemon_status(dsi);
@@ -74,6 +74,7 @@ namespace mining
   const command_line::arg_descriptor<std::string, true> arg_login = {"login", ""};
   const command_line::arg_descriptor<std::string, true> arg_pass = {"pass", ""};
   const command_line::arg_descriptor<uint32_t> arg_mining_threads = { "mining-threads", "Specify mining threads count", 1, true };
+  const command_line::arg_descriptor<uint32_t> arg_mining_lanes = { "mining-lanes", "Specify how many nonces every mining thread hashes together: 1, 2, 4 or 8 (by default chosen by cpu features)", 0, true };
   const command_line::arg_descriptor<std::string, true> arg_scratchpad_url = { "remote_scratchpad", "Specify URL to remote scratchpad"};
   const command_line::arg_descriptor<std::string> arg_scratchpad_local = { "local_scratchpad", "Specify URL to remote scratchpad ", "", true };
 
@@ -87,6 +88,7 @@ namespace mining
     command_line::add_arg(desc, arg_login);
     command_line::add_arg(desc, arg_pass);
     command_line::add_arg(desc, arg_mining_threads);
+    command_line::add_arg(desc, arg_mining_lanes);
     command_line::add_arg(desc, arg_scratchpad_url);
     command_line::add_arg(desc, arg_scratchpad_local);
   }
@@ -280,6 +282,13 @@ namespace mining
       m_threads_total = command_line::get_arg(vm, arg_mining_threads);
       LOG_PRINT_L0("Mining with " << m_threads_total << " threads ");
     }
+    m_lanes_count = crypto::get_wild_keccak_default_lanes_count();
+    if(command_line::has_arg(vm, arg_mining_lanes) && command_line::get_arg(vm, arg_mining_lanes))
+    {
+      m_lanes_count = command_line::get_arg(vm, arg_mining_lanes);
+      CHECK_AND_ASSERT_MES(m_lanes_count == 1 || m_lanes_count == 2 || m_lanes_count == 4 || m_lanes_count == 8, false, "wrong mining lanes count: " << m_lanes_count);
+    }
+    LOG_PRINT_L0("Hashing " << m_lanes_count << " nonces per thread at once" << (crypto::is_wild_keccak_x4_available() ? " (AVX2)" : ""));
     m_pass = command_line::get_arg(vm, arg_pass);
     m_hi = AUTO_VAL_INIT(m_hi);
     m_last_job_ticks = 0;
@@ -324,26 +333,28 @@ namespace mining
   //--------------------------------------------------------------------------------------------------------------------------------
   void simpleminer::worker_thread(uint64_t start_nonce, uint32_t nonce_offset, std::atomic<uint32_t> *result, std::atomic<bool> *do_reset, std::atomic<bool> *done) {
     // printf("Worker thread starting at %lu + %u\n", start_nonce, nonce_offset);
-    currency::blobdata blob = m_job.blob;
+    const size_t lanes_count = m_lanes_count;
+    std::vector<currency::blobdata> blobs(lanes_count, m_job.blob);
+    std::vector<crypto::hash> hashes(lanes_count);
     while (!*do_reset) {
       m_hashes_done += attempts_per_loop;
-      for (int i = 0; i < attempts_per_loop; i++) {
-        (*reinterpret_cast<uint64_t*>(&blob[1])) = (start_nonce+nonce_offset);
-        crypto::hash h = currency::null_hash;
-        currency::get_blob_longhash(blob, h, m_job.prev_hi.height+1, [&](uint64_t index) -> crypto::hash&
-        {
-          return m_fast_scratchpad[index%m_scratchpad.size()];
-        });
+      for (int i = 0; i < attempts_per_loop; i += lanes_count) {
+        for (size_t lane = 0; lane != lanes_count; lane++)
+          (*reinterpret_cast<uint64_t*>(&blobs[lane][1])) = (start_nonce+nonce_offset+lane);
+        currency::get_blobs_longhashes(blobs, hashes, m_job.prev_hi.height+1, m_fast_scratchpad, m_scratchpad.size());
 
-        if( currency::check_hash(h, m_job.difficulty))
+        for (size_t lane = 0; lane != lanes_count; lane++)
         {
-          (*result) = nonce_offset;
-          (*done) = true;
-          (*do_reset) = true;
-          m_work_done_cond.notify_one();
-          return;
+          if( currency::check_hash(hashes[lane], m_job.difficulty))
+          {
+            (*result) = nonce_offset + lane;
+            (*done) = true;
+            (*do_reset) = true;
+            m_work_done_cond.notify_one();
+            return;
+          }
         }
-        nonce_offset++;
+        nonce_offset += lanes_count;
       }
       nonce_offset += ((m_threads_total-1) * attempts_per_loop);
     }
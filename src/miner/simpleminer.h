@@ -79,6 +79,7 @@ namespace mining
     uint64_t m_last_scratchpad_store_time;
     bool m_fast_mmapped;
     uint32_t m_threads_total;
+    size_t m_lanes_count;
     std::atomic<uint64_t> m_hashes_done;
     std::string m_pool_session_id;
     simpleminer::job_details_native m_job;
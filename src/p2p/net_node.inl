@@ -315,6 +315,7 @@ namespace nodetool
 
     m_net_server.add_idle_handler(boost::bind(&node_server<t_payload_net_handler>::idle_worker, this), 1000);
     m_net_server.add_idle_handler(boost::bind(&t_payload_net_handler::on_idle, &m_payload_handler), 1000);
+    m_net_server.add_idle_handler(boost::bind(&t_payload_net_handler::on_tx_relay_idle, &m_payload_handler), CURRENCY_PROTOCOL_TX_RELAY_INTERVAL);
 
     //go to loop
     LOG_PRINT("Run net_service loop( " << thrds_count << " threads)...", LOG_LEVEL_0);
@@ -1061,10 +1062,17 @@ namespace nodetool
         connections.push_back(cntxt.m_connection_id);
       return true;
     });
-
+    return relay_notify(command, data_buff, connections);
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::relay_notify(int command, const std::string& data_buff, const std::list<boost::uuids::uuid>& connections)
+  {
+    //framed once, every connection queues the same buffer
+    epee::net_utils::shared_send_buffer packet = epee::levin::make_notify_packet(command, data_buff);
     BOOST_FOREACH(const auto& c_id, connections)
     {
-      m_net_server.get_config_object().notify(command, data_buff, c_id);
+      m_net_server.get_config_object().notify(packet, c_id);
     }
     return true;
   }
@@ -1306,6 +1314,7 @@ namespace nodetool
   void node_server<t_payload_net_handler>::on_connection_close(p2p_connection_context& context)
   {
     LOG_PRINT_L2("["<< net_utils::print_connection_context(context) << "] CLOSE CONNECTION");
+    m_payload_handler.on_connection_close(context);
   }
   //-----------------------------------------------------------------------------------
 }
@@ -103,6 +103,20 @@ namespace currency
     res.alias_count = m_core.get_blockchain_storage().get_aliases_count();
     m_core.get_blockchain_storage().get_transactions_daily_stat(res.transactions_cnt_per_day, res.transactions_volume_per_day);
 
+    std::map<std::string, db::cache_stats> db_cache_stats;
+    m_core.get_blockchain_storage().get_db_cache_stats(db_cache_stats);
+    for (const auto& cs : db_cache_stats)
+    {
+      db_cache_info& dci = *res.db_caches.insert(res.db_caches.end(), db_cache_info());
+      dci.name = cs.first;
+      dci.hits = cs.second.hits;
+      dci.misses = cs.second.misses;
+      dci.evictions = cs.second.evictions;
+      dci.items_count = cs.second.items_count;
+      dci.size_bytes = cs.second.size_bytes;
+      dci.max_size_bytes = cs.second.max_size_bytes;
+    }
+
     if (!res.outgoing_connections_count)
       res.daemon_network_state = COMMAND_RPC_GET_INFO::daemon_network_state_connecting;
     else if (m_p2p.get_payload_object().is_synchronized())
@@ -130,28 +144,14 @@ namespace currency
     CHECK_CORE_READY();
 
     PROF_L2_START(find_blockchain_supplement_time);
-    std::list<std::pair<block, std::list<transaction> > > bs;
-    if(!m_core.find_blockchain_supplement(req.block_ids, bs, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
+    // stored blobs go to the response as they are, no parse/serialize round trip
+    if(!m_core.find_blockchain_supplement(req.block_ids, res.blocks, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
     {
       res.status = "Failed";
       return false;
     }
     PROF_L2_FINISH(find_blockchain_supplement_time);
-
-    PROF_L2_START(bs_to_res_time);
-    size_t txs_count = 0;
-    for (auto& b : bs)
-    {
-      res.blocks.resize(res.blocks.size()+1);
-      res.blocks.back().block = block_to_blob(b.first);
-      for(auto& t : b.second)
-      {
-        res.blocks.back().txs.push_back(tx_to_blob(t));
-        ++txs_count;
-      }
-    }
-    PROF_L2_FINISH(bs_to_res_time);
-    PROF_L2_LOG_PRINT("RPC: on_get_blocks: " << res.blocks.size() << " blocks, " << txs_count << " txs, timings: " << print_mcsec_as_ms(find_blockchain_supplement_time) << "/" << print_mcsec_as_ms(bs_to_res_time), LOG_LEVEL_1);
+    PROF_L2_LOG_PRINT("RPC: on_get_blocks: " << res.blocks.size() << " blocks, timings: " << print_mcsec_as_ms(find_blockchain_supplement_time), LOG_LEVEL_1);
 
     res.status = CORE_RPC_STATUS_OK;
     return true;
@@ -1375,17 +1375,27 @@ bool core_rpc_server::f_getMixin(const transaction& transaction, uint64_t& mixin
     {
       return true;
     }
+    //the snapshot is shared by all requests until the next block, it goes to the socket by pages without copying
+    blockchain_storage::scratchpad_snapshot_ptr snapshot = m_core.get_blockchain_storage().get_scratchpad_snapshot();
     mining::height_info hi = AUTO_VAL_INIT(hi);
-    get_current_hi(hi);
+    hi.block_id = string_tools::pod_to_hex(snapshot->top_id);
+    hi.height = snapshot->height;
     std::string json_hi;
     epee::serialization::store_t_to_json(hi, json_hi);
     uint32_t str_len = static_cast<uint32_t>(json_hi.size());
-    response_info.m_body.append(reinterpret_cast<const char*>(&str_len), sizeof(str_len));
-    response_info.m_body.append(json_hi.data(), json_hi.size());
-    m_core.get_blockchain_storage().copy_scratchpad_as_blob(response_info.m_body);    
-
-    //TODO: remove this code
-    LOG_PRINT_L0("[getfullscratchpad2]: json prefix len: " << str_len << ", JSON: " << json_hi);
+    boost::shared_ptr<std::string> prefix(new std::string());
+    prefix->append(reinterpret_cast<const char*>(&str_len), sizeof(str_len));
+    prefix->append(json_hi.data(), json_hi.size());
+
+    std::vector<epee::net_utils::shared_send_buffer> buffers;
+    buffers.push_back(prefix);
+    buffers.insert(buffers.end(), snapshot->pages.begin(), snapshot->pages.end());
+    response_info.m_body_stream.reset(new epee::net_utils::buffers_send_stream(buffers));
+    response_info.m_mime_tipe = "application/octet-stream";
+    //lets interrupted downloads be resumed with "Range" and "If-Range" for the same snapshot
+    response_info.m_additional_fields.push_back(std::make_pair("ETag", " \"" + hi.block_id + "\""));
+
+    LOG_PRINT_L1("[getfullscratchpad2]: json prefix len: " << str_len << ", JSON: " << json_hi << ", range: " << epee::net_utils::http::get_value_from_fields_list("Range", query_info.m_header_info.m_etc_fields));
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
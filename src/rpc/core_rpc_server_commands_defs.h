@@ -293,6 +293,27 @@ struct EMPTY_STRUCT {
     };
   };
   //-----------------------------------------------
+  struct db_cache_info
+  {
+    std::string name;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t items_count;
+    uint64_t size_bytes;
+    uint64_t max_size_bytes;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(name)
+      KV_SERIALIZE(hits)
+      KV_SERIALIZE(misses)
+      KV_SERIALIZE(evictions)
+      KV_SERIALIZE(items_count)
+      KV_SERIALIZE(size_bytes)
+      KV_SERIALIZE(max_size_bytes)
+    END_KV_SERIALIZE_MAP()
+  };
+
   struct COMMAND_RPC_GET_INFO
   {
     struct request
@@ -332,6 +353,7 @@ struct EMPTY_STRUCT {
       uint64_t transactions_cnt_per_day;
       uint64_t transactions_volume_per_day;
       nodetool::maintainers_info_external mi;
+      std::list<db_cache_info> db_caches;
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(status)
@@ -355,6 +377,7 @@ struct EMPTY_STRUCT {
         KV_SERIALIZE(transactions_cnt_per_day)
         KV_SERIALIZE(transactions_volume_per_day)
         KV_SERIALIZE(mi)
+        KV_SERIALIZE(db_caches)
       END_KV_SERIALIZE_MAP()
     };
   };    
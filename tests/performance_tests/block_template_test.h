@@ -0,0 +1,93 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/program_options.hpp>
+
+#include "currency_core/blockchain_storage.h"
+#include "currency_core/tx_pool.h"
+
+#define BLOCK_TEMPLATE_POOL_SIZE         10000
+#define BLOCK_TEMPLATE_REQUESTS_COUNT    100
+
+struct block_template_test_env
+{
+  // the same mutual references as in currency::core
+  currency::tx_memory_pool pool;
+  currency::blockchain_storage bcs;
+
+  block_template_test_env() : pool(bcs), bcs(pool) {}
+};
+
+inline currency::transaction make_block_template_test_tx(uint64_t fee)
+{
+  currency::transaction tx = AUTO_VAL_INIT(tx);
+  tx.version = CURRENT_TRANSACTION_VERSION;
+  currency::txin_to_key in = AUTO_VAL_INIT(in);
+  in.amount = TX_POOL_MINIMUM_FEE * 100 + fee;
+  in.key_offsets.push_back(0);
+  in.k_image = crypto::rand<crypto::key_image>();
+  tx.vin.push_back(in);
+  currency::tx_out out = AUTO_VAL_INIT(out);
+  out.amount = TX_POOL_MINIMUM_FEE * 100;
+  out.target = currency::txout_to_key(crypto::rand<crypto::public_key>());
+  tx.vout.push_back(out);
+  tx.signatures.resize(1);
+  tx.signatures[0].resize(1);
+  return tx;
+}
+
+// Measures fill_block_template() for a pool of BLOCK_TEMPLATE_POOL_SIZE transactions with different fees: the first
+// request after a new top block (readiness of transactions is checked) and the following ones for the same top block,
+// like the miner does every few seconds. Transactions spend outputs which don't exist on the fresh chain, so they are
+// kept as by block and none of them is ready, which is the worst case for the template builder.
+void measure_block_template()
+{
+  namespace po = boost::program_options;
+  po::options_description desc;
+  currency::blockchain_storage::init_options(desc);
+  po::variables_map vm;
+  po::store(po::command_line_parser(std::vector<std::string>()).options(desc).run(), vm);
+  po::notify(vm);
+
+  int log_level = epee::log_space::get_set_log_detalisation_level();
+  epee::log_space::get_set_log_detalisation_level(true, LOG_LEVEL_SILENT);
+
+  block_template_test_env env;
+  if (!env.bcs.init(vm, "performance_tests_block_template"))
+  {
+    epee::log_space::get_set_log_detalisation_level(true, log_level);
+    std::cout << "measure_block_template: can't init blockchain" << ENDL;
+    return;
+  }
+
+  env.pool.purge_transactions();
+  for (uint64_t i = 0; i != BLOCK_TEMPLATE_POOL_SIZE; i++)
+  {
+    currency::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+    env.pool.add_tx(make_block_template_test_tx(TX_POOL_MINIMUM_FEE + i * 1000), tvc, true);
+  }
+
+  uint64_t ticks_a = epee::misc_utils::get_tick_count();
+  size_t txs_size = 0;
+  uint64_t fee = 0;
+  currency::block b = AUTO_VAL_INIT(b);
+  bool r = env.pool.fill_block_template(b, CURRENCY_BLOCK_GRANTED_FULL_REWARD_ZONE, 0, 0, txs_size, fee);
+  uint64_t ticks_b = epee::misc_utils::get_tick_count();
+  for (size_t i = 0; i != BLOCK_TEMPLATE_REQUESTS_COUNT; i++)
+  {
+    currency::block next_b = AUTO_VAL_INIT(next_b);
+    r = r && env.pool.fill_block_template(next_b, CURRENCY_BLOCK_GRANTED_FULL_REWARD_ZONE, 0, 0, txs_size, fee);
+  }
+  uint64_t ticks_c = epee::misc_utils::get_tick_count();
+
+  env.pool.purge_transactions();
+  env.bcs.deinit();
+  epee::log_space::get_set_log_detalisation_level(true, log_level);
+
+  std::cout << "block template, pool of " << BLOCK_TEMPLATE_POOL_SIZE << " transactions" << (r ? "" : "\tFAILED") << ENDL <<
+    std::setw(20) << std::left << "first (ms)\t" << std::setw(20) << "next (us)" << ENDL <<
+    std::setw(20) << std::left << ticks_b - ticks_a << "\t" << std::setw(20) << (ticks_c - ticks_b) * 1000 / BLOCK_TEMPLATE_REQUESTS_COUNT << ENDL;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "common/db_bridge.h"
+#include "common/db_lmdb_adapter.h"
+
+#define DB_POINT_LOOKUP_KEYS_COUNT       100000
+#define DB_POINT_LOOKUP_LOOKUPS_PER_THREAD 1000000
+
+// Measures throughput of point lookups made outside of any user transaction (each get() opens its own read-only
+// transaction, like most of the blockchain_storage getters do), for 1..N threads, N = hardware concurrency.
+// Multithreaded, so it should be called before the process is pinned to a single core.
+void measure_db_point_lookups()
+{
+  std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+  db::db_bridge_base dbb(lmdb_ptr);
+  if (!dbb.open("performance_tests_lmdb"))
+  {
+    std::cout << "measure_db_point_lookups: can't open db" << ENDL;
+    return;
+  }
+
+  db::table_id tid = AUTO_VAL_INIT(tid);
+  lmdb_ptr->open_table("point_lookups", tid);
+  dbb.begin_transaction();
+  dbb.clear(tid);
+  for (uint64_t i = 0; i != DB_POINT_LOOKUP_KEYS_COUNT; i++)
+    dbb.set_pod_object(tid, i, i);
+  dbb.commit_transaction();
+
+  std::cout << std::setw(10) << std::left << "threads\t" <<
+    std::setw(10) << "ms\t" <<
+    std::setw(10) << "lookups/sec" << ENDL;
+
+  size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2)
+  {
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    uint64_t ticks_a = epee::misc_utils::get_tick_count();
+    for (size_t t = 0; t != threads_count; t++)
+    {
+      threads.emplace_back([&dbb, &failed, tid, t]()
+      {
+        uint64_t k = t, v = 0;
+        for (size_t n = 0; n != DB_POINT_LOOKUP_LOOKUPS_PER_THREAD; n++)
+        {
+          k = k * 6364136223846793005ull + 1442695040888963407ull; // LCG, just to spread lookups over the table
+          uint64_t key = (k >> 16) % DB_POINT_LOOKUP_KEYS_COUNT;
+          if (!dbb.get_pod_object(tid, key, v) || v != key)
+            failed = true;
+        }
+      });
+    }
+    for (auto& th : threads)
+      th.join();
+    uint64_t ticks_b = epee::misc_utils::get_tick_count();
+
+    uint64_t ms = std::max<uint64_t>(ticks_b - ticks_a, 1);
+    std::cout << std::setw(10) << std::left << threads_count << "\t" <<
+      std::setw(10) << ms << "\t" <<
+      std::setw(10) << threads_count * DB_POINT_LOOKUP_LOOKUPS_PER_THREAD * 1000 / ms << (failed ? "\tFAILED" : "") << ENDL;
+  }
+
+  dbb.close();
+}
@@ -119,6 +119,20 @@ public:
 };
 
 
+template<int scratchpad_size>
+class test_wild_keccak_mixer: public test_wild_keccak<scratchpad_size>
+{
+public:
+  bool test()
+  {
+    this->pretest();
+
+    crypto::hash h;
+    crypto::wild_keccak_dbl<crypto::mul_f>(reinterpret_cast<const uint8_t*>(&this->m_buff[0]), this->m_buff.size(), reinterpret_cast<uint8_t*>(&h), sizeof(h), crypto::scratchpad_mixer(this->m_scratchpad_vec.data(), this->m_scratchpad_vec.size()));
+    return true;
+  }
+};
+
 template<int scratchpad_size>
 class test_wild_keccak2: public test_keccak_base
   {
@@ -181,3 +195,39 @@ void measure_keccak_over_scratchpad()
                  std::setw(10) << ticks_c - ticks_b << ENDL;   
   }
 }
+
+#define lanes_hashrate_rounds 20000
+// Miner-like hashrate (hashes/sec, one thread) for every count of nonces hashed together
+void measure_wild_keccak_lanes_hashrate()
+{
+  std::cout << "wild_keccak lanes, AVX2: " << (crypto::is_wild_keccak_x4_available() ? "yes" : "no") << ENDL;
+  std::cout << std::setw(20) << std::left << "sz\t" <<
+    std::setw(10) << "1 lane\t" << std::setw(10) << "2 lanes\t" << std::setw(10) << "4 lanes\t" << std::setw(10) << "8 lanes" << ENDL;
+
+  currency::block b = AUTO_VAL_INIT(b);
+  const uint64_t sizes[] = { 400, 4000000, 40000000, 100000000 };
+  for (uint64_t sz : sizes)
+  {
+    std::vector<crypto::hash> scratchpad_vec(sz / sizeof(crypto::hash));
+    for (auto& h : scratchpad_vec)
+      h = crypto::rand<crypto::hash>();
+
+    std::cout << std::setw(20) << std::left << sz;
+    for (size_t lanes_count : { 1, 2, 4, 8 })
+    {
+      std::vector<currency::blobdata> blobs(lanes_count, currency::get_block_hashing_blob(b));
+      std::vector<crypto::hash> hashes;
+      uint64_t nonce = 0;
+      uint64_t ticks_a = epee::misc_utils::get_tick_count();
+      for (size_t r = 0; r < lanes_hashrate_rounds; r += lanes_count)
+      {
+        for (auto& bl : blobs)
+          *reinterpret_cast<uint64_t*>(&bl[1]) = nonce++;
+        currency::get_blobs_longhashes(blobs, hashes, 1, scratchpad_vec.data(), scratchpad_vec.size());
+      }
+      uint64_t ticks_b = epee::misc_utils::get_tick_count();
+      std::cout << "\t" << std::setw(10) << lanes_hashrate_rounds * 1000 / std::max<uint64_t>(ticks_b - ticks_a, 1);
+    }
+    std::cout << ENDL;
+  }
+}
@@ -15,15 +15,23 @@
 #include "generate_key_image_helper.h"
 #include "is_out_to_acc.h"
 #include "keccak_test.h"
+#include "db_point_lookup_test.h"
+#include "ring_signature_throughput.h"
+#include "block_template_test.h"
 
 int main(int argc, char** argv)
 {
+  measure_db_point_lookups();
+
   set_process_affinity(1);
   set_thread_high_priority();
 
   performance_timer timer;
   timer.start();
 
+  measure_ring_signature_throughput();
+  measure_block_template();
+
   //TEST_PERFORMANCE0(test_keccak);
   //TEST_PERFORMANCE0(test_keccak_alt1);  
    
@@ -32,16 +40,22 @@ int main(int argc, char** argv)
   
   TEST_PERFORMANCE1(test_wild_keccak, 400);
   TEST_PERFORMANCE1(test_wild_keccak2, 400);
+  TEST_PERFORMANCE1(test_wild_keccak_mixer, 400);
   
   TEST_PERFORMANCE1(test_wild_keccak, 40000);
   TEST_PERFORMANCE1(test_wild_keccak2, 40000);
+  TEST_PERFORMANCE1(test_wild_keccak_mixer, 40000);
   TEST_PERFORMANCE1(test_wild_keccak, 4000000);
   TEST_PERFORMANCE1(test_wild_keccak2, 4000000);
+  TEST_PERFORMANCE1(test_wild_keccak_mixer, 4000000);
   TEST_PERFORMANCE1(test_wild_keccak, 40000000);
   TEST_PERFORMANCE1(test_wild_keccak2, 40000000);
+  TEST_PERFORMANCE1(test_wild_keccak_mixer, 40000000);
   TEST_PERFORMANCE1(test_wild_keccak, 100000000);
   TEST_PERFORMANCE1(test_wild_keccak2, 100000000);
+  TEST_PERFORMANCE1(test_wild_keccak_mixer, 100000000);
 
+  measure_wild_keccak_lanes_hashrate();
   measure_keccak_over_scratchpad();
   /*
   TEST_PERFORMANCE2(test_construct_tx, 1, 1);
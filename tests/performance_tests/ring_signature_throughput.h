@@ -0,0 +1,107 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <vector>
+
+#include "crypto/crypto.h"
+
+#define RING_SIGNATURE_THROUGHPUT_SIGNATURES_COUNT   200
+#define RING_SIGNATURE_THROUGHPUT_DECOYS_POOL_SIZE   1000
+
+struct ring_signature_throughput_entry
+{
+  crypto::hash prefix_hash;
+  crypto::key_image image;
+  std::vector<crypto::public_key> pubs;
+  std::vector<crypto::signature> sigs;
+};
+
+// decoys are taken from the pool if it's not empty, otherwise fresh keys are generated for each ring
+inline void make_ring_signature_throughput_entry(size_t ring_size, const std::vector<crypto::public_key>& decoys_pool, ring_signature_throughput_entry& e)
+{
+  e.prefix_hash = crypto::rand<crypto::hash>();
+  crypto::public_key real_pub;
+  crypto::secret_key real_sec;
+  crypto::generate_keys(real_pub, real_sec);
+  crypto::generate_key_image(real_pub, real_sec, e.image);
+
+  size_t real_index = crypto::rand<size_t>() % ring_size;
+  e.pubs.resize(ring_size);
+  for (size_t i = 0; i != ring_size; i++)
+  {
+    if (i == real_index)
+      e.pubs[i] = real_pub;
+    else if (decoys_pool.size())
+      e.pubs[i] = decoys_pool[crypto::rand<size_t>() % decoys_pool.size()];
+    else
+    {
+      crypto::secret_key sec;
+      crypto::generate_keys(e.pubs[i], sec);
+    }
+  }
+
+  std::vector<const crypto::public_key*> pubs_ptrs;
+  for (const auto& p : e.pubs)
+    pubs_ptrs.push_back(&p);
+  e.sigs.resize(ring_size);
+  crypto::generate_ring_signature(e.prefix_hash, e.image, pubs_ptrs, real_sec, real_index, e.sigs.data());
+}
+
+// Measures check_ring_signature() throughput for ring sizes 1..50, with decoys that are never seen again
+// (each ring member is decompressed) and with decoys drawn from a small pool (as with popular outputs).
+void measure_ring_signature_throughput()
+{
+  std::vector<crypto::public_key> decoys_pool(RING_SIGNATURE_THROUGHPUT_DECOYS_POOL_SIZE);
+  for (auto& p : decoys_pool)
+  {
+    crypto::secret_key sec;
+    crypto::generate_keys(p, sec);
+  }
+
+  std::cout << std::setw(10) << std::left << "ring size\t" <<
+    std::setw(16) << "fresh, sig/sec\t" <<
+    std::setw(16) << "pooled, sig/sec" << ENDL;
+
+  const size_t ring_sizes[] = { 1, 2, 3, 4, 5, 6, 8, 10, 12, 15, 20, 25, 30, 40, 50 };
+  for (size_t ring_size : ring_sizes)
+  {
+    uint64_t results[2] = { 0, 0 };
+    for (size_t pooled = 0; pooled != 2; pooled++)
+    {
+      std::vector<ring_signature_throughput_entry> entries(RING_SIGNATURE_THROUGHPUT_SIGNATURES_COUNT);
+      for (auto& e : entries)
+        make_ring_signature_throughput_entry(ring_size, pooled ? decoys_pool : std::vector<crypto::public_key>(), e);
+
+      std::vector<const crypto::public_key*> pubs_ptrs;
+      if (pooled)
+      {
+        // steady state: pool members have been seen in earlier rings already
+        for (const auto& p : decoys_pool)
+        {
+          const crypto::public_key* pp = &p;
+          crypto::check_ring_signature(entries[0].prefix_hash, entries[0].image, &pp, 1, entries[0].sigs.data());
+        }
+      }
+      uint64_t ticks_a = epee::misc_utils::get_tick_count();
+      for (const auto& e : entries)
+      {
+        pubs_ptrs.clear();
+        for (const auto& p : e.pubs)
+          pubs_ptrs.push_back(&p);
+        if (!crypto::check_ring_signature(e.prefix_hash, e.image, pubs_ptrs, e.sigs.data()))
+        {
+          std::cout << "check_ring_signature failed for ring size " << ring_size << ENDL;
+          return;
+        }
+      }
+      uint64_t ticks_b = epee::misc_utils::get_tick_count();
+      results[pooled] = entries.size() * 1000 / std::max<uint64_t>(ticks_b - ticks_a, 1);
+    }
+    std::cout << std::setw(10) << std::left << ring_size << "\t" <<
+      std::setw(16) << results[0] << "\t" <<
+      std::setw(16) << results[1] << ENDL;
+  }
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <boost/uuid/random_generator.hpp>
+#include "include_base_utils.h"
+#include "currency_core/block_download_scheduler.h"
+
+using namespace currency;
+
+namespace
+{
+  std::list<crypto::hash> make_ids(uint64_t from, uint64_t to)
+  {
+    std::list<crypto::hash> ids;
+    for (uint64_t i = from; i != to; i++)
+      ids.push_back(crypto::cn_fast_hash(&i, sizeof i));
+    return ids;
+  }
+
+  std::list<block_complete_entry> make_blocks(const std::list<crypto::hash>& ids)
+  {
+    std::list<block_complete_entry> blocks(ids.size());
+    return blocks;
+  }
+}
+
+TEST(block_download_scheduler, spans_are_requested_from_several_connections)
+{
+  block_download_scheduler sch(10, 2, 100, 60);
+  boost::uuids::random_generator gen;
+  boost::uuids::uuid c1 = gen(), c2 = gen(), c3 = gen();
+
+  ASSERT_TRUE(sch.add_chain(100, make_ids(100, 145)));
+  ASSERT_TRUE(sch.is_active());
+
+  std::list<std::list<crypto::hash> > r1, r2, r3;
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 1000, r1));
+  ASSERT_EQ(2, r1.size());
+  ASSERT_EQ(make_ids(100, 110), r1.front());
+  ASSERT_EQ(make_ids(110, 120), r1.back());
+
+  // per connection limit
+  r1.clear();
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 1000, r1));
+  ASSERT_TRUE(r1.empty());
+
+  // the last span is beyond remote height of this connection
+  ASSERT_EQ(1, sch.get_spans_to_request(c2, 2, 135, r2));
+  ASSERT_EQ(make_ids(120, 130), r2.front());
+
+  ASSERT_EQ(2, sch.get_spans_to_request(c3, 3, 1000, r3));
+  ASSERT_EQ(make_ids(130, 140), r3.front());
+  ASSERT_EQ(make_ids(140, 145), r3.back());
+
+  size_t queued = 0, requested = 0, received = 0;
+  sch.get_stats(queued, requested, received);
+  ASSERT_EQ(0, queued);
+  ASSERT_EQ(5, requested);
+  ASSERT_EQ(0, received);
+}
+
+TEST(block_download_scheduler, spans_are_applied_in_height_order)
+{
+  block_download_scheduler sch(10, 4, 100, 60);
+  boost::uuids::random_generator gen;
+  boost::uuids::uuid c1 = gen(), c2 = gen(), c3 = gen();
+
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 30)));
+  std::list<std::list<crypto::hash> > r1, r2;
+  ASSERT_EQ(1, sch.get_spans_to_request(c1, 1, 10, r1));
+  ASSERT_EQ(2, sch.get_spans_to_request(c2, 2, 100, r2));
+
+  // not requested from this connection, or wrong blocks count
+  std::list<block_complete_entry> blocks = make_blocks(r1.front());
+  ASSERT_FALSE(sch.on_span_received(c3, blocks));
+  blocks = make_blocks(make_ids(0, 9));
+  ASSERT_FALSE(sch.on_span_received(c1, blocks));
+
+  std::atomic<uint64_t> applied_height(0);
+  boost::thread applier([&]()
+  {
+    block_download_scheduler::span s = AUTO_VAL_INIT(s);
+    while (sch.wait_next_span(s))
+    {
+      ASSERT_EQ(applied_height.load(), s.start_height);
+      ASSERT_EQ(s.ids.size(), s.blocks.size());
+      ASSERT_EQ(s.start_height == 0 ? c1 : c2, s.connection_id);
+      applied_height += s.ids.size();
+      sch.on_span_applied(s);
+    }
+  });
+
+  // out of order spans wait for the lowest one
+  blocks = make_blocks(r2.front());
+  ASSERT_TRUE(sch.on_span_received(c2, blocks));
+  blocks = make_blocks(r2.back());
+  ASSERT_TRUE(sch.on_span_received(c2, blocks));
+  boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+  ASSERT_EQ(0, applied_height.load());
+
+  blocks = make_blocks(r1.front());
+  ASSERT_TRUE(sch.on_span_received(c1, blocks));
+  for (size_t i = 0; i != 100 && sch.is_active(); i++)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(10));
+  ASSERT_FALSE(sch.is_active());
+  ASSERT_EQ(30, applied_height.load());
+
+  sch.stop();
+  applier.join();
+}
+
+TEST(block_download_scheduler, window_is_bounded)
+{
+  block_download_scheduler sch(10, 100, 3, 60);
+  boost::uuids::uuid c1 = boost::uuids::random_generator()();
+
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 100)));
+  std::list<std::list<crypto::hash> > r;
+  ASSERT_EQ(3, sch.get_spans_to_request(c1, 1, 1000, r));
+
+  // downloaded spans stay in the window until applied
+  std::list<block_complete_entry> blocks = make_blocks(r.front());
+  ASSERT_TRUE(sch.on_span_received(c1, blocks));
+  r.clear();
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 1000, r));
+  ASSERT_TRUE(r.empty());
+}
+
+TEST(block_download_scheduler, closed_and_timed_out_requests_go_back_to_queue)
+{
+  block_download_scheduler sch(10, 2, 100, 0);
+  boost::uuids::random_generator gen;
+  boost::uuids::uuid c1 = gen(), c2 = gen();
+
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 20)));
+  std::list<std::list<crypto::hash> > r1, r2;
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 100, r1));
+  ASSERT_EQ(2, sch.on_connection_closed(c1));
+  ASSERT_EQ(0, sch.get_requests_count(c1));
+
+  ASSERT_EQ(2, sch.get_spans_to_request(c2, 2, 100, r2));
+  ASSERT_EQ(r1, r2);
+
+  // late response to a timed out request is ignored, the span is given to another connection
+  ASSERT_EQ(2, sch.check_timeouts());
+  std::list<block_complete_entry> blocks = make_blocks(r2.front());
+  ASSERT_TRUE(sch.on_span_received(c2, blocks));
+  ASSERT_TRUE(sch.on_span_received(c2, blocks));
+  ASSERT_FALSE(sch.on_span_received(c2, blocks));
+
+  r1.clear();
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 100, r1));
+  ASSERT_EQ(r1, r2);
+}
+
+TEST(block_download_scheduler, chain_continuation)
+{
+  block_download_scheduler sch(10, 10, 100, 60);
+  boost::uuids::uuid c1 = boost::uuids::random_generator()();
+
+  crypto::hash last_id = null_hash;
+  ASSERT_FALSE(sch.start_chain_request(1000, last_id));
+  ASSERT_FALSE(sch.continue_chain(make_ids(0, 10)));
+
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 15)));
+  // another chain is not taken while this one is downloaded
+  ASSERT_FALSE(sch.add_chain(50, make_ids(50, 60)));
+
+  ASSERT_FALSE(sch.start_chain_request(15, last_id));
+  ASSERT_TRUE(sch.start_chain_request(1000, last_id));
+  ASSERT_EQ(make_ids(14, 15).front(), last_id);
+  // one chain request at a time
+  ASSERT_FALSE(sch.start_chain_request(1000, last_id));
+
+  // response starts with the last scheduled id, the not requested last span is topped up
+  ASSERT_TRUE(sch.continue_chain(make_ids(14, 40)));
+  std::list<std::list<crypto::hash> > r;
+  ASSERT_EQ(4, sch.get_spans_to_request(c1, 1, 1000, r));
+  ASSERT_EQ(make_ids(0, 10), r.front());
+  ASSERT_EQ(make_ids(10, 20), *(++r.begin()));
+  ASSERT_EQ(make_ids(30, 40), r.back());
+
+  sch.reset();
+  ASSERT_FALSE(sch.is_active());
+  ASSERT_TRUE(sch.add_chain(50, make_ids(50, 60)));
+}
+
+TEST(block_download_scheduler, spans_taken_before_reset_are_outdated)
+{
+  block_download_scheduler sch(10, 10, 100, 60);
+  boost::uuids::uuid c1 = boost::uuids::random_generator()();
+
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 20)));
+  std::list<std::list<crypto::hash> > r;
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 1000, r));
+  std::list<block_complete_entry> blocks = make_blocks(r.front());
+  ASSERT_TRUE(sch.on_span_received(c1, blocks));
+  block_download_scheduler::span s = AUTO_VAL_INIT(s);
+  ASSERT_TRUE(sch.wait_next_span(s));
+  ASSERT_FALSE(sch.is_outdated(s));
+
+  sch.reset();
+  ASSERT_TRUE(sch.is_outdated(s));
+  ASSERT_TRUE(sch.add_chain(0, make_ids(0, 20)));
+  block_download_scheduler::span s2 = AUTO_VAL_INIT(s2);
+  r.clear();
+  ASSERT_EQ(2, sch.get_spans_to_request(c1, 1, 1000, r));
+  blocks = make_blocks(r.front());
+  // the response to the request made before reset is ignored
+  ASSERT_TRUE(sch.on_span_received(c1, blocks));
+  ASSERT_TRUE(sch.on_span_received(c1, blocks));
+  ASSERT_TRUE(sch.wait_next_span(s2));
+
+  // outdated span doesn't affect the current chain
+  sch.on_span_applied(s);
+  ASSERT_TRUE(sch.is_active());
+  sch.on_span_applied(s2);
+  ASSERT_TRUE(sch.is_active());
+}
@@ -0,0 +1,94 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "currency_core/currency_format_utils.h"
+#include "currency_core/block_import_pipeline.h"
+
+using namespace currency;
+
+namespace
+{
+  transaction make_tx(uint64_t height)
+  {
+    transaction tx = AUTO_VAL_INIT(tx);
+    tx.version = CURRENT_TRANSACTION_VERSION;
+    txin_gen in;
+    in.height = height;
+    tx.vin.push_back(in);
+    tx.signatures.resize(1);
+    return tx;
+  }
+
+  // span of blocks with one transaction each, as received from a connection
+  block_download_scheduler::span make_span(uint64_t start_height, size_t count)
+  {
+    block_download_scheduler::span s = AUTO_VAL_INIT(s);
+    s.start_height = start_height;
+    for (uint64_t h = start_height; h != start_height + count; h++)
+    {
+      transaction tx = make_tx(h);
+      block b = AUTO_VAL_INIT(b);
+      b.major_version = CURRENT_BLOCK_MAJOR_VERSION;
+      b.timestamp = h;
+      b.miner_tx = make_tx(h);
+      b.tx_hashes.push_back(get_transaction_hash(tx));
+
+      block_complete_entry bce;
+      bce.block = block_to_blob(b);
+      bce.txs.push_back(tx_to_blob(tx));
+      s.blocks.push_back(bce);
+      s.ids.push_back(get_block_hash(b));
+    }
+    return s;
+  }
+}
+
+TEST(block_import_pipeline, prevalidate_span)
+{
+  block_download_scheduler::span s = make_span(10, 3);
+  std::list<crypto::hash> ids = s.ids;
+  size_t checked_txs = 0;
+  prevalidated_span ps = AUTO_VAL_INIT(ps);
+  ASSERT_TRUE(block_import_pipeline::prevalidate_span(s, ps, [&](const transaction&, const crypto::hash&){ ++checked_txs; return true; }));
+  ASSERT_TRUE(ps.valid);
+  ASSERT_EQ(3, ps.blocks.size());
+  ASSERT_EQ(3, checked_txs);
+  ASSERT_TRUE(ps.source.blocks.empty());
+  auto id_it = ids.begin();
+  for (const prevalidated_block& pb : ps.blocks)
+  {
+    ASSERT_EQ(*id_it++, pb.id);
+    ASSERT_EQ(1, pb.txs.size());
+    ASSERT_EQ(pb.bl.tx_hashes, pb.tx_hashes);
+  }
+}
+
+TEST(block_import_pipeline, prevalidate_span_rejects_wrong_blocks)
+{
+  prevalidated_span ps = AUTO_VAL_INIT(ps);
+
+  // block which is not the requested one
+  block_download_scheduler::span s = make_span(10, 3);
+  s.ids.back() = null_hash;
+  ASSERT_FALSE(block_import_pipeline::prevalidate_span(s, ps, block_import_pipeline::tx_check_t()));
+  ASSERT_FALSE(ps.valid);
+
+  // transaction which is not the block's one
+  s = make_span(10, 3);
+  s.blocks.front().txs.front() = tx_to_blob(make_tx(100));
+  ASSERT_FALSE(block_import_pipeline::prevalidate_span(s, ps, block_import_pipeline::tx_check_t()));
+
+  // unparsable block
+  s = make_span(10, 3);
+  s.blocks.back().block = "garbage";
+  ASSERT_FALSE(block_import_pipeline::prevalidate_span(s, ps, block_import_pipeline::tx_check_t()));
+
+  // transaction failed context free checks
+  s = make_span(10, 3);
+  ASSERT_FALSE(block_import_pipeline::prevalidate_span(s, ps, [](const transaction&, const crypto::hash&){ return false; }));
+  ASSERT_FALSE(ps.valid);
+}
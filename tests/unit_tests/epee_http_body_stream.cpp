@@ -0,0 +1,89 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "net/net_utils_base.h"
+#include "net/http_base.h"
+
+using namespace epee::net_utils;
+
+namespace
+{
+  std::string read_all(i_send_stream& s, std::vector<shared_send_buffer>* parts = nullptr)
+  {
+    std::string res;
+    for (shared_send_buffer part = s.get_next_part(); part; part = s.get_next_part())
+    {
+      res += *part;
+      if (parts)
+        parts->push_back(part);
+    }
+    return res;
+  }
+
+  std::vector<shared_send_buffer> make_buffers()
+  {
+    std::vector<shared_send_buffer> buffers;
+    buffers.push_back(shared_send_buffer(new std::string("0123")));
+    buffers.push_back(shared_send_buffer(new std::string("45678")));
+    buffers.push_back(shared_send_buffer(new std::string("9")));
+    return buffers;
+  }
+}
+
+TEST(epee_http_body_stream, buffers_are_shared_and_ranges_copy_edges_only)
+{
+  std::vector<shared_send_buffer> buffers = make_buffers();
+  buffers_send_stream whole(buffers);
+  ASSERT_EQ(10, whole.get_size());
+  std::vector<shared_send_buffer> parts;
+  ASSERT_EQ("0123456789", read_all(whole, &parts));
+  ASSERT_EQ(3, parts.size());
+  for (size_t i = 0; i != parts.size(); i++)
+    ASSERT_EQ(buffers[i].get(), parts[i].get());
+  ASSERT_FALSE(whole.get_next_part());
+
+  buffers_send_stream middle(buffers);
+  ASSERT_TRUE(middle.set_range(2, 7));
+  ASSERT_EQ(7, middle.get_size());
+  parts.clear();
+  ASSERT_EQ("2345678", read_all(middle, &parts));
+  ASSERT_EQ(2, parts.size());
+  ASSERT_EQ(buffers[1].get(), parts[1].get());
+
+  buffers_send_stream tail(buffers);
+  ASSERT_TRUE(tail.set_range(9, 1));
+  ASSERT_EQ("9", read_all(tail));
+
+  buffers_send_stream wrong(buffers);
+  ASSERT_FALSE(wrong.set_range(5, 6));
+  ASSERT_FALSE(wrong.set_range(11, 0));
+}
+
+TEST(epee_http_body_stream, parse_bytes_range)
+{
+  uint64_t offset = 0, count = 0;
+  ASSERT_EQ(http::http_range_ok, http::parse_bytes_range("bytes=0-99", 1000, offset, count));
+  ASSERT_EQ(0, offset);
+  ASSERT_EQ(100, count);
+  ASSERT_EQ(http::http_range_ok, http::parse_bytes_range(" bytes=500-", 1000, offset, count));
+  ASSERT_EQ(500, offset);
+  ASSERT_EQ(500, count);
+  ASSERT_EQ(http::http_range_ok, http::parse_bytes_range("bytes=900-5000", 1000, offset, count));
+  ASSERT_EQ(900, offset);
+  ASSERT_EQ(100, count);
+  ASSERT_EQ(http::http_range_ok, http::parse_bytes_range("bytes=-10", 1000, offset, count));
+  ASSERT_EQ(990, offset);
+  ASSERT_EQ(10, count);
+
+  ASSERT_EQ(http::http_range_not_satisfiable, http::parse_bytes_range("bytes=1000-", 1000, offset, count));
+  ASSERT_EQ(http::http_range_not_satisfiable, http::parse_bytes_range("bytes=-0", 1000, offset, count));
+
+  ASSERT_EQ(http::http_range_none, http::parse_bytes_range("bytes=0-1,5-6", 1000, offset, count));
+  ASSERT_EQ(http::http_range_none, http::parse_bytes_range("bytes=10-5", 1000, offset, count));
+  ASSERT_EQ(http::http_range_none, http::parse_bytes_range("items=0-5", 1000, offset, count));
+  ASSERT_EQ(http::http_range_none, http::parse_bytes_range("bytes=a-", 1000, offset, count));
+}
@@ -384,6 +384,33 @@ TEST_F(positive_test_connection_to_levin_protocol_handler_calls, handler_process
   ASSERT_TRUE(conn->last_send_data().empty());
 }
 
+TEST_F(positive_test_connection_to_levin_protocol_handler_calls, shared_notify_packet_is_sent_to_several_connections)
+{
+  // Setup
+  const int expected_command = 4673262;
+
+  test_connection_ptr conn1 = create_connection();
+  test_connection_ptr conn2 = create_connection();
+  test_connection_ptr receiver = create_connection();
+
+  std::string in_data(256, 'e');
+  epee::net_utils::shared_send_buffer packet = epee::levin::make_notify_packet(expected_command, in_data);
+
+  // Test
+  ASSERT_EQ(1, conn1->m_protocol_handler.notify(packet));
+  ASSERT_EQ(1, conn2->m_protocol_handler.notify(packet));
+
+  // Check both connections sent the same framed packet, and it's handled as notify by the other side
+  ASSERT_EQ(1, conn1->send_counter());
+  ASSERT_EQ(*packet, conn1->last_send_data());
+  ASSERT_EQ(*packet, conn2->last_send_data());
+
+  ASSERT_TRUE(receiver->m_protocol_handler.handle_recv(packet->data(), packet->size()));
+  ASSERT_EQ(1, m_commands_handler.notify_counter());
+  ASSERT_EQ(expected_command, m_commands_handler.last_command());
+  ASSERT_EQ(in_data, m_commands_handler.last_in_buf());
+}
+
 TEST_F(positive_test_connection_to_levin_protocol_handler_calls, handler_processes_qued_callback)
 {
   test_connection_ptr conn = create_connection();
@@ -0,0 +1,79 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "syncobj.h"
+
+TEST(recursive_shared_critical_section, recursion)
+{
+  epee::recursive_shared_critical_section cs;
+
+  // nested shared: only the outermost call acquires the lock
+  ASSERT_TRUE(cs.lock_shared());
+  ASSERT_FALSE(cs.lock_shared());
+  cs.unlock_shared();
+  // shared -> exclusive upgrade is not allowed
+  ASSERT_THROW(cs.lock(), std::logic_error);
+  cs.unlock_shared();
+
+  // exclusive owner can re-enter both sides
+  cs.lock();
+  cs.lock();
+  ASSERT_FALSE(cs.lock_shared());
+  cs.unlock_shared();
+  cs.unlock();
+  cs.unlock();
+
+  // lock should be free now
+  ASSERT_TRUE(cs.lock_shared());
+  cs.unlock_shared();
+}
+
+TEST(recursive_shared_critical_section, concurrency)
+{
+  epee::recursive_shared_critical_section cs;
+  const size_t threads_count = 4;
+  std::atomic<size_t> shared_owners(0);
+  std::atomic<size_t> max_shared_owners(0);
+  std::atomic<bool> exclusive_violated(false);
+  size_t counter = 0;
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < threads_count; ++i)
+  {
+    threads.emplace_back([&]()
+    {
+      for (size_t n = 0; n < 200; ++n)
+      {
+        cs.lock_shared();
+        size_t owners = ++shared_owners;
+        size_t prev_max = max_shared_owners;
+        while (owners > prev_max && !max_shared_owners.compare_exchange_weak(prev_max, owners));
+        cs.lock_shared(); // nested shared region must not block even if a writer is waiting
+        std::this_thread::yield();
+        cs.unlock_shared();
+        --shared_owners;
+        cs.unlock_shared();
+
+        cs.lock();
+        if (shared_owners != 0)
+          exclusive_violated = true;
+        ++counter;
+        cs.unlock();
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+
+  ASSERT_FALSE(exclusive_violated);
+  ASSERT_EQ(threads_count * 200, counter);
+  LOG_PRINT_L0("max simultaneous shared owners: " << max_shared_owners);
+}
@@ -465,6 +465,172 @@ namespace lmdb_test
     ASSERT_TRUE(r);
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // get_and_visit_test
+  //////////////////////////////////////////////////////////////////////////////
+  TEST(lmdb, get_and_visit_test)
+  {
+    std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+    db::db_bridge_base dbb(lmdb_ptr);
+
+    ASSERT_TRUE(dbb.open("get_and_visit_test"));
+
+    db::table_id tid_decapod;
+    ASSERT_TRUE(lmdb_ptr->open_table("decapod", tid_decapod));
+
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(dbb.clear(tid_decapod));
+
+    simple_serializable_t s_object;
+    s_object.number = 1001100102;
+    s_object.name = "bender";
+    ASSERT_TRUE(dbb.set_serializable_object(tid_decapod, null_hash, s_object));
+
+    simple_pod_t p_object = { 'x', 0xf7f7f7f7d3d3d3d3ull, 2.002319f };
+    uint64_t pod_key = 42;
+    ASSERT_TRUE(dbb.set_pod_object(tid_decapod, pod_key, p_object));
+    dbb.commit_transaction();
+
+    // raw view, no outer transaction: the adapter keeps its local read transaction until the callback returns
+    std::string blob;
+    ASSERT_TRUE(currency::t_serializable_object_to_blob(s_object, blob));
+    bool r = dbb.get_and_visit(tid_decapod, null_hash, [&](const void* value_data, size_t value_size) -> bool
+    {
+      return value_size == blob.size() && memcmp(value_data, blob.data(), value_size) == 0;
+    });
+    ASSERT_TRUE(r);
+
+    // visitor's result is passed through
+    r = dbb.get_and_visit(tid_decapod, null_hash, [&](const void* value_data, size_t value_size) -> bool { return false; });
+    ASSERT_FALSE(r);
+
+    // missing key: visitor should never be called
+    bool called = false;
+    r = dbb.get_and_visit(tid_decapod, crypto::cn_fast_hash(&null_hash, sizeof null_hash), [&](const void* value_data, size_t value_size) -> bool { called = true; return true; });
+    ASSERT_FALSE(r);
+    ASSERT_FALSE(called);
+
+    // in-place unserialization inside and outside of a transaction
+    simple_serializable_t s_object2 = AUTO_VAL_INIT(s_object2);
+    ASSERT_TRUE(dbb.get_serializable_object(tid_decapod, null_hash, s_object2));
+    ASSERT_EQ(s_object, s_object2);
+
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    simple_pod_t p_object2 = AUTO_VAL_INIT(p_object2);
+    ASSERT_TRUE(dbb.get_pod_object(tid_decapod, pod_key, p_object2));
+    ASSERT_EQ(p_object, p_object2);
+    dbb.commit_transaction();
+
+    // size mismatch must be detected
+    uint64_t wrong_size_pod = 0;
+    ASSERT_FALSE(dbb.get_pod_object(tid_decapod, pod_key, wrong_size_pod));
+
+    ASSERT_TRUE(dbb.close());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // nested_read_only_transaction_test
+  //////////////////////////////////////////////////////////////////////////////
+  TEST(lmdb, nested_read_only_transaction_test)
+  {
+    std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+    db::db_bridge_base dbb(lmdb_ptr);
+
+    ASSERT_TRUE(dbb.open("nested_read_only_transaction_test"));
+
+    db::table_id tid_decapod;
+    ASSERT_TRUE(lmdb_ptr->open_table("decapod", tid_decapod));
+
+    uint64_t key = 7, value = 0;
+
+    // read-only transaction within write transaction should see uncommitted changes of the parent
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(dbb.clear(tid_decapod));
+    ASSERT_TRUE(dbb.set_pod_object(tid_decapod, key, uint64_t(1)));
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    ASSERT_TRUE(dbb.get_pod_object(tid_decapod, key, value));
+    ASSERT_EQ(1, value);
+    dbb.commit_transaction();
+    // parent transaction should still be usable
+    ASSERT_TRUE(dbb.set_pod_object(tid_decapod, key, uint64_t(2)));
+    dbb.commit_transaction();
+
+    // read-only within read-only, table size within read-only
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    ASSERT_TRUE(dbb.get_pod_object(tid_decapod, key, value));
+    ASSERT_EQ(2, value);
+    dbb.commit_transaction();
+    ASSERT_EQ(1, dbb.size(tid_decapod));
+    dbb.commit_transaction();
+
+    // aborting nested read-only transaction should not affect the parent
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(dbb.set_pod_object(tid_decapod, key, uint64_t(3)));
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    dbb.abort_transaction();
+    dbb.commit_transaction();
+    ASSERT_TRUE(dbb.get_pod_object(tid_decapod, key, value));
+    ASSERT_EQ(3, value);
+
+    ASSERT_TRUE(dbb.close());
+  }
+
+  //////////////////////////////////////////////////////////////////////////////
+  // read_transaction_reuse_test
+  //////////////////////////////////////////////////////////////////////////////
+  TEST(lmdb, read_transaction_reuse_test)
+  {
+    std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+    db::db_bridge_base dbb(lmdb_ptr);
+
+    ASSERT_TRUE(dbb.open("read_transaction_reuse_test"));
+    db::table_id tid_decapod;
+    ASSERT_TRUE(lmdb_ptr->open_table("decapod", tid_decapod));
+
+    uint64_t key = 11, value = 0;
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(dbb.clear(tid_decapod));
+    ASSERT_TRUE(dbb.set_pod_object(tid_decapod, key, uint64_t(1)));
+    dbb.commit_transaction();
+
+    // renewed reader handle should see the latest snapshot, not the one it was created with
+    for (uint64_t i = 2; i < 10; ++i)
+    {
+      ASSERT_TRUE(dbb.get_pod_object(tid_decapod, key, value));
+      ASSERT_EQ(i - 1, value);
+      ASSERT_TRUE(dbb.begin_transaction());
+      ASSERT_TRUE(dbb.set_pod_object(tid_decapod, key, i));
+      dbb.commit_transaction();
+    }
+
+    // short-lived threads: each one leaves its reader handle behind
+    std::atomic<size_t> failures(0);
+    for (size_t n = 0; n < 4; ++n)
+    {
+      std::vector<std::thread> threads;
+      for (size_t t = 0; t < 4; ++t)
+        threads.emplace_back([&]()
+        {
+          uint64_t v = 0;
+          for (size_t i = 0; i < 100; ++i)
+            if (!dbb.get_pod_object(tid_decapod, key, v) || v != 9)
+              ++failures;
+        });
+      for (auto& th : threads)
+        th.join();
+    }
+    ASSERT_EQ(0, failures);
+
+    // cached reader handle must not survive reopening
+    ASSERT_TRUE(dbb.close());
+    ASSERT_TRUE(dbb.open("read_transaction_reuse_test"));
+    ASSERT_TRUE(lmdb_ptr->open_table("decapod", tid_decapod));
+    ASSERT_TRUE(dbb.get_pod_object(tid_decapod, key, value));
+    ASSERT_EQ(9, value);
+    ASSERT_TRUE(dbb.close());
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // single_value_test
   //////////////////////////////////////////////////////////////////////////////
@@ -676,6 +842,117 @@ namespace lmdb_test
     ASSERT_TRUE(dbb.close());
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // array_subitems_test
+  //////////////////////////////////////////////////////////////////////////////
+#pragma pack(push, 1)
+  struct test_out_entry
+  {
+    crypto::hash tx_id;
+    uint64_t n;
+  };
+#pragma pack(pop)
+
+  TEST(lmdb, array_subitems_test)
+  {
+    const std::string array_table_name("test_array_subitems");
+
+    std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+    db::db_bridge_base dbb(lmdb_ptr);
+
+    db::key_to_array_accessor_base<uint64_t, test_out_entry, false> db_array(dbb);
+
+    ASSERT_TRUE(dbb.open("array_subitems_test"));
+
+    db::table_id tid;
+    ASSERT_TRUE(lmdb_ptr->open_table(array_table_name, tid));
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(dbb.clear(tid));
+    dbb.commit_transaction();
+    ASSERT_TRUE(db_array.init(array_table_name));
+
+    // more than 256 items per array, so that db key order differs from index order; neighbour arrays must not interfere
+    const size_t items_count = 1000;
+    ASSERT_TRUE(dbb.begin_transaction());
+    for (size_t i = 0; i != items_count; ++i)
+    {
+      db_array.push_back_item(96, test_out_entry{ null_hash, i + 100000 });
+      db_array.push_back_item(97, test_out_entry{ crypto::cn_fast_hash(&i, sizeof i), i });
+      db_array.push_back_item(98, test_out_entry{ null_hash, i + 200000 });
+    }
+    dbb.commit_transaction();
+
+    // range
+    std::vector<std::shared_ptr<const test_out_entry>> items;
+    db_array.get_subitems(97, 0, items_count, items);
+    ASSERT_EQ(items_count, items.size());
+    for (size_t i = 0; i != items_count; ++i)
+    {
+      ASSERT_TRUE((bool)items[i]);
+      ASSERT_EQ(i, items[i]->n);
+      ASSERT_EQ(crypto::cn_fast_hash(&i, sizeof i), items[i]->tx_id);
+    }
+
+    db_array.get_subitems(97, 250, 260, items);
+    ASSERT_EQ(10, items.size());
+    for (size_t i = 0; i != items.size(); ++i)
+      ASSERT_EQ(250 + i, items[i]->n);
+
+    db_array.get_subitems(97, 5, 5, items);
+    ASSERT_TRUE(items.empty());
+
+    // random indices, with repetitions, within an outer transaction
+    std::vector<size_t> indices;
+    for (size_t i = 0; i != 300; ++i)
+      indices.push_back(random_t_from_range<size_t>(0, items_count - 1));
+    indices.push_back(indices.front());
+
+    ASSERT_TRUE(dbb.begin_transaction(true));
+    db_array.get_subitems(97, indices, items);
+    dbb.commit_transaction();
+    ASSERT_EQ(indices.size(), items.size());
+    for (size_t k = 0; k != indices.size(); ++k)
+    {
+      ASSERT_EQ(indices[k], items[k]->n);
+      ASSERT_EQ(db_array.get_subitem(97, indices[k])->tx_id, items[k]->tx_id);
+    }
+
+    // out of range index
+    indices.push_back(items_count);
+    bool r = false;
+    try
+    {
+      db_array.get_subitems(97, indices, items);
+    }
+    catch (...)
+    {
+      r = true;
+    }
+    ASSERT_TRUE(r);
+
+    // in-place update
+    ASSERT_TRUE(dbb.begin_transaction());
+    db_array.set_subitem(97, 300, test_out_entry{ null_hash, 777 });
+    dbb.commit_transaction();
+    ASSERT_EQ(items_count, db_array.get_item_size(97));
+    ASSERT_EQ(777, db_array.get_subitem(97, 300)->n);
+    ASSERT_EQ(null_hash, db_array.get_subitem(97, 300)->tx_id);
+    ASSERT_EQ(301, db_array.get_subitem(97, 301)->n);
+
+    r = false;
+    try
+    {
+      db_array.set_subitem(97, items_count, test_out_entry{ null_hash, 0 });
+    }
+    catch (...)
+    {
+      r = true;
+    }
+    ASSERT_TRUE(r);
+
+    ASSERT_TRUE(dbb.close());
+  }
+
   //////////////////////////////////////////////////////////////////////////////
   // array_accessor_test
   //////////////////////////////////////////////////////////////////////////////
@@ -781,4 +1058,112 @@ namespace lmdb_test
     db_array.commit_transaction();
   }
 
+  //////////////////////////////////////////////////////////////////////////////
+  // cached_accessor_test
+  //////////////////////////////////////////////////////////////////////////////
+  TEST(lmdb, cached_accessor_test)
+  {
+    const std::string table_name("cached_table");
+
+    std::shared_ptr<db::lmdb_adapter> lmdb_ptr = std::make_shared<db::lmdb_adapter>();
+    db::db_bridge_base dbb(lmdb_ptr);
+    db::key_value_accessor_base<uint64_t, serializable_string, true> db_table(dbb);
+    db_table.enable_cache(1024 * 1024);
+
+    ASSERT_TRUE(dbb.open("cached_accessor_test"));
+    ASSERT_TRUE(db_table.init(table_name));
+
+    const uint64_t items_count = 100;
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(db_table.clear());
+    for (uint64_t i = 0; i != items_count; ++i)
+      db_table.set(i, serializable_string(std::to_string(i)));
+    dbb.commit_transaction();
+
+    // first reads miss, second ones hit
+    for (size_t n = 0; n != 2; ++n)
+      for (uint64_t i = 0; i != items_count; ++i)
+        ASSERT_EQ(std::to_string(i), db_table.get(i)->v);
+    db::cache_stats cs = AUTO_VAL_INIT(cs);
+    ASSERT_TRUE(db_table.get_cache_stats(cs));
+    ASSERT_EQ(items_count, cs.misses);
+    ASSERT_EQ(items_count, cs.hits);
+    ASSERT_EQ(items_count, cs.items_count);
+
+    // uncommitted change is visible to the writer only and never gets cached
+    ASSERT_TRUE(dbb.begin_transaction());
+    db_table.set(7, serializable_string("seven"));
+    ASSERT_EQ("seven", db_table.get(7)->v);
+    std::thread([&]() { ASSERT_EQ("7", db_table.get(7)->v); ASSERT_EQ("8", db_table.get(8)->v); }).join();
+    ASSERT_EQ("seven", db_table.get(7)->v);
+    dbb.abort_transaction();
+    ASSERT_EQ("7", db_table.get(7)->v);
+
+    ASSERT_TRUE(dbb.begin_transaction());
+    db_table.set(7, serializable_string("seven"));
+    std::thread([&]() { ASSERT_EQ("7", db_table.get(7)->v); }).join();
+    db_table.erase(8);
+    dbb.commit_transaction();
+    ASSERT_EQ("seven", db_table.get(7)->v);
+    ASSERT_FALSE(db_table.get(8));
+    std::thread([&]() { ASSERT_EQ("seven", db_table.get(7)->v); ASSERT_FALSE(db_table.get(8)); }).join();
+
+    // batch operation
+    ASSERT_TRUE(dbb.begin_batch_exclusive_operation());
+    ASSERT_TRUE(dbb.begin_transaction());
+    db_table.set(9, serializable_string("nine"));
+    dbb.commit_transaction();
+    ASSERT_EQ("nine", db_table.get(9)->v);
+    ASSERT_TRUE(dbb.finish_batch_exclusive_operation(true));
+    ASSERT_EQ("nine", db_table.get(9)->v);
+
+    ASSERT_TRUE(dbb.begin_transaction());
+    ASSERT_TRUE(db_table.clear());
+    dbb.commit_transaction();
+    ASSERT_FALSE(db_table.get(7));
+    ASSERT_TRUE(db_table.get_cache_stats(cs));
+    ASSERT_EQ(0, cs.items_count);
+
+    ASSERT_TRUE(dbb.close());
+  }
+
+  TEST(lmdb, lru_cache_eviction_test)
+  {
+    const uint64_t max_size = 16 * 1024;
+    db::sharded_lru_cache<uint64_t, std::string, db::tkey_hasher<uint64_t>, db::tkey_equal<uint64_t>> cache(max_size, 4);
+
+    std::shared_ptr<const std::string> v;
+    uint64_t generation = 0;
+    for (uint64_t i = 0; i != 1000; ++i)
+    {
+      ASSERT_FALSE(cache.get(i, v, generation));
+      cache.put(i, std::make_shared<const std::string>(std::to_string(i)), 100, generation);
+    }
+    db::cache_stats cs = cache.get_stats();
+    ASSERT_LE(cs.size_bytes, max_size);
+    ASSERT_GT(cs.evictions, 0);
+    ASSERT_EQ(1000, cs.items_count + cs.evictions);
+
+    // most recently used items survive
+    ASSERT_TRUE(cache.get(999, v, generation));
+    ASSERT_EQ("999", *v);
+    ASSERT_FALSE(cache.get(0, v, generation));
+
+    // value read before the end of a write transaction is not cached
+    ASSERT_FALSE(cache.get(0, v, generation));
+    cache.on_write_transaction_end();
+    cache.put(0, std::make_shared<const std::string>("0"), 100, generation);
+    ASSERT_FALSE(cache.get(0, v, generation));
+
+    // modified key is not cached until the end of the write transaction
+    cache.on_key_modified(1);
+    ASSERT_FALSE(cache.get(1, v, generation));
+    cache.put(1, std::make_shared<const std::string>("1"), 100, generation);
+    ASSERT_FALSE(cache.get(1, v, generation));
+    cache.on_write_transaction_end();
+    ASSERT_FALSE(cache.get(1, v, generation));
+    cache.put(1, std::make_shared<const std::string>("1"), 100, generation);
+    ASSERT_TRUE(cache.get(1, v, generation));
+  }
+
 }
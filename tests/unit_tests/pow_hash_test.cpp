@@ -160,3 +160,82 @@ TEST(pow_tests, test_reference_func)
   ASSERT_TRUE(r);
 }
 
+
+TEST(pow_tests, fast_mod64)
+{
+  const uint64_t divisors[] = { 1, 2, 3, 7, 1000, 0xFFFFFFFFULL, 0x100000000ULL, 0x123456789ABCDEFULL, UINT64_MAX / 2, UINT64_MAX / 2 + 1, UINT64_MAX - 1, UINT64_MAX };
+  for (uint64_t d : divisors)
+  {
+    crypto::fast_mod64 m(d);
+    const uint64_t values[] = { 0, 1, d - 1, d, d + 1, 2 * d - 1, UINT64_MAX - d, UINT64_MAX - 1, UINT64_MAX };
+    for (uint64_t x : values)
+      ASSERT_EQ(x % d, m.mod(x)) << "x=" << x << ", d=" << d;
+    for (size_t i = 0; i != 10000; i++)
+    {
+      uint64_t x = crypto::rand<uint64_t>();
+      ASSERT_EQ(x % d, m.mod(x)) << "x=" << x << ", d=" << d;
+    }
+  }
+}
+
+TEST(pow_tests, scratchpad_mixer_matches_callback)
+{
+  const uint64_t sizes[] = { 1, 2, 3, 5, 64, 1001, 65536, 100003 };
+  for (uint64_t sz : sizes)
+  {
+    std::vector<crypto::hash> scratchpad(sz);
+    for (auto& h : scratchpad)
+      h = crypto::rand<crypto::hash>();
+
+    for (size_t i = 0; i != 20; i++)
+    {
+      std::string blob(76 + i * 13, '\0');
+      crypto::generate_random_bytes(blob.size(), &blob[0]);
+
+      crypto::hash expected = null_hash;
+      get_blob_longhash(blob, expected, 1, [&](uint64_t index) -> const crypto::hash&
+      {
+        return scratchpad[index%scratchpad.size()];
+      });
+      ASSERT_EQ(expected, get_blob_longhash(blob, 1, scratchpad));
+    }
+  }
+}
+
+TEST(pow_tests, lanes_match_single_hashing)
+{
+  std::vector<crypto::hash> scratchpad(100003);
+  for (auto& h : scratchpad)
+    h = crypto::rand<crypto::hash>();
+
+  for (size_t lanes_count : { 1, 2, 4, 8 })
+  {
+    for (size_t blob_size : { 1, 76, 135, 136, 137, 300 })
+    {
+      std::vector<blobdata> blobs(lanes_count, std::string(blob_size, '\0'));
+      for (auto& b : blobs)
+        crypto::generate_random_bytes(b.size(), &b[0]);
+
+      for (uint64_t height : { 0, 1 })
+      {
+        std::vector<crypto::hash> hashes;
+        ASSERT_TRUE(get_blobs_longhashes(blobs, hashes, height, scratchpad.data(), scratchpad.size()));
+        ASSERT_EQ(lanes_count, hashes.size());
+        for (size_t lane = 0; lane != lanes_count; lane++)
+        {
+          crypto::hash expected = null_hash;
+          get_blob_longhash(blobs[lane], expected, height, [&](uint64_t index) -> const crypto::hash&
+          {
+            return scratchpad[index%scratchpad.size()];
+          });
+          ASSERT_EQ(expected, hashes[lane]) << "lanes: " << lanes_count << ", blob size: " << blob_size << ", height: " << height;
+        }
+      }
+    }
+  }
+
+  // blobs hashed together must be of the same size
+  std::vector<blobdata> blobs = { blobdata(76, 'a'), blobdata(77, 'b') };
+  std::vector<crypto::hash> hashes;
+  ASSERT_FALSE(get_blobs_longhashes(blobs, hashes, 1, scratchpad.data(), scratchpad.size()));
+}
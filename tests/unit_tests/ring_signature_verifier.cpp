@@ -0,0 +1,76 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "currency_core/currency_basic.h"
+#include "currency_core/ring_signature_verifier.h"
+
+namespace
+{
+  currency::ring_signature_check_job make_job(size_t ring_size, size_t n)
+  {
+    currency::ring_signature_check_job job = AUTO_VAL_INIT(job);
+    job.input_index = n;
+    job.prefix_hash = crypto::cn_fast_hash(&n, sizeof n);
+
+    crypto::secret_key real_sec = AUTO_VAL_INIT(real_sec);
+    size_t real_index = n % ring_size;
+    job.output_keys.resize(ring_size);
+    for (size_t i = 0; i != ring_size; i++)
+    {
+      crypto::secret_key sec = AUTO_VAL_INIT(sec);
+      crypto::generate_keys(job.output_keys[i], sec);
+      if (i == real_index)
+        real_sec = sec;
+    }
+    crypto::generate_key_image(job.output_keys[real_index], real_sec, job.k_image);
+
+    std::vector<const crypto::public_key*> pubs;
+    for (auto& k : job.output_keys)
+      pubs.push_back(&k);
+    job.signatures.resize(ring_size);
+    crypto::generate_ring_signature(job.prefix_hash, job.k_image, pubs, real_sec, real_index, job.signatures.data());
+    return job;
+  }
+}
+
+TEST(ring_signature_verifier, batch_verification)
+{
+  std::vector<currency::ring_signature_check_job> jobs;
+  for (size_t n = 0; n != 40; n++)
+    jobs.push_back(make_job(1 + n % 4, n));
+
+  for (size_t threads_count : { 1, 4 })
+  {
+    currency::ring_signature_verifier verifier;
+    ASSERT_TRUE(verifier.init(threads_count));
+    ASSERT_EQ(threads_count, verifier.get_threads_count());
+
+    size_t failed_index = 0;
+    ASSERT_TRUE(verifier.verify(jobs, failed_index));
+    ASSERT_EQ(jobs.size(), failed_index);
+
+    std::vector<currency::ring_signature_check_job> empty_jobs;
+    ASSERT_TRUE(verifier.verify(empty_jobs, failed_index));
+
+    // the smallest index of failed jobs is reported
+    std::vector<currency::ring_signature_check_job> bad_jobs = jobs;
+    bad_jobs[31].prefix_hash = currency::null_hash;
+    bad_jobs[17].k_image = bad_jobs[18].k_image;
+    ASSERT_FALSE(verifier.verify(bad_jobs, failed_index));
+    ASSERT_EQ(17, failed_index);
+
+    // signatures count mismatch
+    bad_jobs = jobs;
+    bad_jobs[5].signatures.pop_back();
+    ASSERT_FALSE(verifier.verify(bad_jobs, failed_index));
+    ASSERT_EQ(5, failed_index);
+
+    // the pool is reusable after a failed batch
+    ASSERT_TRUE(verifier.verify(jobs, failed_index));
+    verifier.deinit();
+  }
+}
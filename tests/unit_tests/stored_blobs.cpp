@@ -0,0 +1,113 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "currency_core/currency_basic.h"
+#include "currency_core/currency_format_utils.h"
+#include "currency_core/blockchain_storage.h"
+
+using namespace currency;
+
+namespace
+{
+  transaction make_transaction(size_t inputs_count, size_t ring_size)
+  {
+    transaction tx = AUTO_VAL_INIT(tx);
+    tx.version = CURRENT_TRANSACTION_VERSION;
+    tx.unlock_time = 12345;
+    for (size_t i = 0; i != inputs_count; i++)
+    {
+      txin_to_key in = AUTO_VAL_INIT(in);
+      in.amount = 1000 * (i + 1);
+      for (size_t j = 0; j != ring_size; j++)
+        in.key_offsets.push_back(j + 300);
+      crypto::hash h = crypto::cn_fast_hash(&i, sizeof i);
+      memcpy(&in.k_image, &h, sizeof in.k_image);
+      tx.vin.push_back(in);
+
+      tx.signatures.push_back(std::vector<crypto::signature>(ring_size));
+      for (size_t j = 0; j != ring_size; j++)
+        crypto::cn_fast_hash(&j, sizeof j, reinterpret_cast<crypto::hash&>(tx.signatures.back()[j]));
+    }
+    for (size_t i = 0; i != 3; i++)
+    {
+      tx_out out = AUTO_VAL_INIT(out);
+      out.amount = 500 * (i + 1);
+      txout_to_key tk = AUTO_VAL_INIT(tk);
+      crypto::hash h = crypto::cn_fast_hash(&i, sizeof i);
+      memcpy(&tk.key, &h, sizeof tk.key);
+      out.target = tk;
+      tx.vout.push_back(out);
+    }
+    tx.extra.resize(40, 7);
+    return tx;
+  }
+}
+
+TEST(stored_blobs, block_blob_from_stored_entry)
+{
+  blockchain_storage::block_extended_info bei = AUTO_VAL_INIT(bei);
+  bei.bl.major_version = CURRENT_BLOCK_MAJOR_VERSION;
+  bei.bl.timestamp = 1400000000;
+  bei.bl.nonce = 0x1122334455667788;
+  bei.bl.prev_id = crypto::cn_fast_hash("prev", 4);
+  txin_gen in = AUTO_VAL_INIT(in);
+  in.height = 100500;
+  bei.bl.miner_tx.vin.push_back(in);
+  bei.bl.miner_tx.vout = make_transaction(0, 0).vout;
+  for (size_t i = 0; i != 5; i++)
+    bei.bl.tx_hashes.push_back(crypto::cn_fast_hash(&i, sizeof i));
+  bei.height = 100500;
+  bei.block_cumulative_size = 777;
+  bei.cumulative_difficulty = 123456789;
+  bei.cumulative_difficulty <<= 70;
+  bei.already_generated_coins = 1;
+  bei.already_donated_coins = 2;
+  bei.scratch_offset = 3;
+
+  blobdata stored = t_serializable_object_to_blob(bei);
+  blobdata blob;
+  ASSERT_TRUE(blockchain_storage::get_block_blob_from_stored_entry(stored.data(), stored.size(), blob));
+  ASSERT_EQ(block_to_blob(bei.bl), blob);
+
+  ASSERT_FALSE(blockchain_storage::get_block_blob_from_stored_entry(stored.data(), 10, blob));
+}
+
+TEST(stored_blobs, transaction_blob_from_stored_entry)
+{
+  blockchain_storage::transaction_chain_entry tce = AUTO_VAL_INIT(tce);
+  tce.tx = make_transaction(3, 4);
+  tce.m_keeper_block_height = 100500;
+  tce.m_global_output_indexes.push_back(1);
+  tce.m_global_output_indexes.push_back(300);
+  tce.m_global_output_indexes.push_back(1ull << 40);
+  tce.m_spent_flags.push_back(false);
+  tce.m_spent_flags.push_back(true);
+  tce.m_spent_flags.push_back(false);
+
+  blobdata stored = t_serializable_object_to_blob(tce);
+  blobdata blob;
+  ASSERT_TRUE(blockchain_storage::get_transaction_blob_from_stored_entry(stored.data(), stored.size(), blob));
+  ASSERT_EQ(tx_to_blob(tce.tx), blob);
+
+  // entry of version 1 layout: tx goes right after the versions
+  uint32_t old_version = 1;
+  blobdata old_stored = t_serializable_object_to_blob(old_version) + t_serializable_object_to_blob(old_version) + tx_to_blob(tce.tx) +
+    t_serializable_object_to_blob(tce.m_keeper_block_height) + t_serializable_object_to_blob(tce.m_global_output_indexes) +
+    t_serializable_object_to_blob(tce.m_spent_flags);
+  blockchain_storage::transaction_chain_entry old_tce = AUTO_VAL_INIT(old_tce);
+  ASSERT_TRUE(t_unserializable_object_from_blob(old_tce, old_stored));
+  ASSERT_EQ(tce.m_keeper_block_height, old_tce.m_keeper_block_height);
+  ASSERT_EQ(tce.m_global_output_indexes, old_tce.m_global_output_indexes);
+  ASSERT_EQ(tce.m_spent_flags, old_tce.m_spent_flags);
+
+  blob.clear();
+  ASSERT_TRUE(blockchain_storage::get_transaction_blob_from_stored_entry(old_stored.data(), old_stored.size(), blob));
+  ASSERT_EQ(tx_to_blob(tce.tx), blob);
+
+  // stored again, old entry gets the current layout
+  ASSERT_EQ(stored, t_serializable_object_to_blob(old_tce));
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2012-2018 The Boolberry developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gtest/gtest.h"
+
+#include <boost/uuid/random_generator.hpp>
+#include "include_base_utils.h"
+#include "currency_core/tx_relay_queue.h"
+
+using namespace currency;
+
+namespace
+{
+  std::list<crypto::hash> make_ids(uint64_t from, uint64_t to)
+  {
+    std::list<crypto::hash> ids;
+    for (uint64_t i = from; i != to; i++)
+      ids.push_back(crypto::cn_fast_hash(&i, sizeof i));
+    return ids;
+  }
+
+  const std::list<crypto::hash>* find_batch(const tx_relay_queue::batches_t& batches, const boost::uuids::uuid& id)
+  {
+    for (const auto& b : batches)
+      if (b.first == id)
+        return &b.second;
+    return nullptr;
+  }
+}
+
+TEST(tx_relay_queue, known_transactions_are_not_announced)
+{
+  tx_relay_queue q(100, 1000, 10);
+  boost::uuids::uuid c1 = boost::uuids::random_generator()();
+  boost::uuids::uuid c2 = boost::uuids::random_generator()();
+  q.add_connection(c1);
+  q.add_connection(c2);
+
+  std::list<crypto::hash> txs = make_ids(0, 5);
+  // c1 is the one the transactions came from
+  q.add_known(c1, txs);
+  q.queue(txs);
+
+  tx_relay_queue::batches_t batches;
+  q.get_batches(batches);
+  ASSERT_EQ(1, batches.size());
+  ASSERT_TRUE(find_batch(batches, c2) != nullptr);
+  ASSERT_EQ(txs, *find_batch(batches, c2));
+
+  // announced ones are known too
+  q.queue(txs);
+  q.get_batches(batches);
+  ASSERT_TRUE(batches.empty());
+
+  q.remove_connection(c2);
+  ASSERT_FALSE(q.has_connection(c2));
+  q.queue(make_ids(5, 6));
+  q.get_batches(batches);
+  ASSERT_EQ(1, batches.size());
+  ASSERT_EQ(c1, batches.front().first);
+  ASSERT_EQ(make_ids(5, 6), batches.front().second);
+}
+
+TEST(tx_relay_queue, batches_and_known_filter_are_bounded)
+{
+  tx_relay_queue q(10, 4, 10);
+  boost::uuids::uuid c1 = boost::uuids::random_generator()();
+  q.add_connection(c1);
+
+  q.queue(make_ids(0, 10));
+  tx_relay_queue::batches_t batches;
+  size_t announced = 0;
+  for (q.get_batches(batches); !batches.empty(); q.get_batches(batches))
+  {
+    ASSERT_LE(batches.front().second.size(), 4);
+    announced += batches.front().second.size();
+  }
+  ASSERT_EQ(10, announced);
+
+  // the oldest known ids are forgotten when the filter is full
+  q.queue(make_ids(10, 11));
+  q.queue(make_ids(0, 1));
+  q.get_batches(batches);
+  ASSERT_EQ(make_ids(10, 11).front(), batches.front().second.front());
+  ASSERT_EQ(make_ids(0, 1).front(), batches.front().second.back());
+}
+
+TEST(tx_relay_queue, transactions_are_requested_once)
+{
+  tx_relay_queue q(100, 100, 1000);
+  std::list<crypto::hash> txs = make_ids(0, 3);
+  q.filter_requested(txs);
+  ASSERT_EQ(3, txs.size());
+
+  txs = make_ids(0, 5);
+  q.filter_requested(txs);
+  ASSERT_EQ(make_ids(3, 5), txs);
+
+  q.on_requested_received(make_ids(0, 1));
+  txs = make_ids(0, 5);
+  q.filter_requested(txs);
+  ASSERT_EQ(make_ids(0, 1), txs);
+}